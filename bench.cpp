@@ -0,0 +1,503 @@
+#define FOOD_DELIVERY_NO_MAIN
+#include "project.cpp"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+struct City
+{
+    string generator;
+    int nodes;
+    vector<Edge> edges;
+    vector<int> restaurants;
+    vector<int> deliveries;
+};
+
+struct BenchOptions
+{
+    vector<string> generators;
+    vector<int> sizes;
+    int samples;
+    int agentsPer1000;
+    int ordersPerTick;
+    int ticks;
+    bool buildHierarchy;
+    bool buildTable;
+    string dataRoot;
+    unsigned seed;
+
+    BenchOptions()
+        : generators({"grid", "geometric", "road"}), sizes({1000, 10000, 100000}), samples(200),
+          agentsPer1000(20), ordersPerTick(64), ticks(20), buildHierarchy(true), buildTable(true),
+          dataRoot("bench_data"), seed(42) {}
+};
+
+class NullBuffer : public streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+};
+
+class SilenceCout
+{
+private:
+    NullBuffer sink;
+    streambuf *saved;
+
+public:
+    SilenceCout() : saved(cout.rdbuf(&sink)) {}
+    ~SilenceCout() { cout.rdbuf(saved); }
+};
+
+void makeDirectory(const string &path)
+{
+#ifdef _WIN32
+    _mkdir(path.c_str());
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+}
+
+void assignNodeTypes(City &city, mt19937 &rng)
+{
+    for (int v = 0; v < city.nodes; v++)
+    {
+        int roll = rng() % 100;
+        if (roll < 2)
+            city.restaurants.push_back(v);
+        else if (roll < 22)
+            city.deliveries.push_back(v);
+    }
+    if (city.restaurants.empty())
+        city.restaurants.push_back(0);
+    if (city.deliveries.empty())
+        city.deliveries.push_back(city.nodes - 1);
+}
+
+City generateGrid(int n, mt19937 &rng)
+{
+    City city;
+    city.generator = "grid";
+    int side = max(2, (int)sqrt((double)n));
+    city.nodes = side * side;
+    for (int r = 0; r < side; r++)
+    {
+        for (int c = 0; c < side; c++)
+        {
+            int v = r * side + c;
+            if (c + 1 < side)
+                city.edges.push_back(Edge(v, v + 1, 1 + rng() % 9));
+            if (r + 1 < side)
+                city.edges.push_back(Edge(v, v + side, 1 + rng() % 9));
+        }
+    }
+    assignNodeTypes(city, rng);
+    return city;
+}
+
+City generateGeometric(int n, mt19937 &rng)
+{
+    City city;
+    city.generator = "geometric";
+    city.nodes = n;
+
+    int side = max(1, (int)sqrt((double)n));
+    uniform_real_distribution<double> coord(0.0, side);
+    vector<double> x(n), y(n);
+    vector<vector<int>> cells((size_t)side * side);
+    for (int v = 0; v < n; v++)
+    {
+        x[v] = coord(rng);
+        y[v] = coord(rng);
+        int cx = min(side - 1, (int)x[v]);
+        int cy = min(side - 1, (int)y[v]);
+        cells[(size_t)cy * side + cx].push_back(v);
+    }
+
+    vector<pair<long long, int>> seen;
+    for (int v = 0; v < n; v++)
+    {
+        int cx = min(side - 1, (int)x[v]);
+        int cy = min(side - 1, (int)y[v]);
+        vector<pair<double, int>> near;
+        for (int radius = 1; near.size() < 3 && radius <= side; radius++)
+        {
+            near.clear();
+            for (int dy = -radius; dy <= radius; dy++)
+            {
+                for (int dx = -radius; dx <= radius; dx++)
+                {
+                    int nx = cx + dx;
+                    int ny = cy + dy;
+                    if (nx < 0 || ny < 0 || nx >= side || ny >= side)
+                        continue;
+                    for (int u : cells[(size_t)ny * side + nx])
+                    {
+                        if (u != v)
+                            near.push_back(make_pair(hypot(x[u] - x[v], y[u] - y[v]), u));
+                    }
+                }
+            }
+        }
+        sort(near.begin(), near.end());
+        for (int k = 0; k < (int)near.size() && k < 3; k++)
+        {
+            int a = min(v, near[k].second);
+            int b = max(v, near[k].second);
+            seen.push_back(make_pair((long long)a * n + b, max(1, (int)round(near[k].first * 2))));
+        }
+    }
+    sort(seen.begin(), seen.end());
+    for (int i = 0; i < (int)seen.size(); i++)
+    {
+        if (i > 0 && seen[i].first == seen[i - 1].first)
+            continue;
+        city.edges.push_back(Edge(seen[i].first / n, seen[i].first % n, seen[i].second));
+    }
+    assignNodeTypes(city, rng);
+    return city;
+}
+
+City generateRoad(int n, mt19937 &rng)
+{
+    City city;
+    city.generator = "road";
+    int side = max(2, (int)sqrt((double)n));
+    city.nodes = side * side;
+    for (int r = 0; r < side; r++)
+    {
+        for (int c = 0; c < side; c++)
+        {
+            int v = r * side + c;
+            bool arterialRow = r % 10 == 0;
+            bool arterialCol = c % 10 == 0;
+            if (c + 1 < side && (arterialRow || rng() % 100 >= 15))
+                city.edges.push_back(Edge(v, v + 1, arterialRow ? 1 : 2 + rng() % 3));
+            if (r + 1 < side && (arterialCol || rng() % 100 >= 15))
+                city.edges.push_back(Edge(v, v + side, arterialCol ? 1 : 2 + rng() % 3));
+        }
+    }
+    for (int r = 0; r + 10 < side; r += 10)
+    {
+        for (int c = 0; c + 10 < side; c += 10)
+        {
+            city.edges.push_back(Edge(r * side + c, (r + 10) * side + c + 10, 10));
+        }
+    }
+    assignNodeTypes(city, rng);
+    return city;
+}
+
+City generateCity(const string &generator, int n, mt19937 &rng)
+{
+    if (generator == "geometric")
+        return generateGeometric(n, rng);
+    if (generator == "road")
+        return generateRoad(n, rng);
+    return generateGrid(n, rng);
+}
+
+void writeCity(const City &city, const string &dir, int agentCount, mt19937 &rng)
+{
+    makeDirectory(dir);
+
+    vector<string> types(city.nodes, "intersection");
+    for (int v : city.restaurants)
+        types[v] = "restaurant";
+    for (int v : city.deliveries)
+        types[v] = "delivery";
+
+    ofstream nodes(dir + "/nodes.csv");
+    nodes << "nodeId,name,type\n";
+    for (int v = 0; v < city.nodes; v++)
+    {
+        nodes << v << ",Node " << v << "," << types[v] << "\n";
+    }
+
+    ofstream edges(dir + "/edges.csv");
+    edges << "source,destination,weight,streetName\n";
+    for (int e = 0; e < (int)city.edges.size(); e++)
+    {
+        edges << city.edges[e].src << "," << city.edges[e].dest << "," << city.edges[e].weight
+              << ",Road " << e % 1000 << "\n";
+    }
+
+    ofstream restaurants(dir + "/restaurants.csv");
+    restaurants << "id,name,nodeId\n";
+    for (int i = 0; i < (int)city.restaurants.size(); i++)
+    {
+        restaurants << i + 1 << ",Restaurant " << i + 1 << "," << city.restaurants[i] << "\n";
+    }
+
+    ofstream agents(dir + "/agents.csv");
+    agents << "id,name,nodeId\n";
+    for (int i = 0; i < agentCount; i++)
+    {
+        agents << i + 1 << ",Agent " << i + 1 << "," << rng() % city.nodes << "\n";
+    }
+
+    ofstream(dir + "/users.csv") << "id,name,nodeId\n";
+    ofstream(dir + "/orders.csv") << "orderId,userId,restaurantId,agentId,priority,status\n";
+}
+
+class Samples
+{
+private:
+    vector<double> micros;
+
+public:
+    template <typename Function>
+    void time(Function body)
+    {
+        auto start = chrono::steady_clock::now();
+        body();
+        micros.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+    }
+
+    void report(const string &benchCase, const City &city, int operationsPerSample = 1)
+    {
+        if (micros.empty())
+            return;
+        vector<double> sorted = micros;
+        sort(sorted.begin(), sorted.end());
+        double total = 0;
+        for (double m : sorted)
+            total += m;
+        double p50 = sorted[sorted.size() / 2];
+        double p99 = sorted[min(sorted.size() - 1, (size_t)(sorted.size() * 0.99))];
+        double throughput = total > 0 ? sorted.size() * operationsPerSample / (total / 1e6) : 0;
+
+        printf("{\"case\":\"%s\",\"generator\":\"%s\",\"nodes\":%d,\"edges\":%d,\"samples\":%d,"
+               "\"p50_us\":%.2f,\"p99_us\":%.2f,\"mean_us\":%.2f,\"throughput_per_s\":%.2f}\n",
+               benchCase.c_str(), city.generator.c_str(), city.nodes, (int)city.edges.size(), (int)sorted.size(),
+               p50, p99, total / sorted.size(), throughput);
+        fflush(stdout);
+    }
+};
+
+void runCity(const City &city, const BenchOptions &options, mt19937 &rng)
+{
+    string dir = options.dataRoot + "/" + city.generator + "_" + to_string(city.nodes);
+    int agentCount = max(1, city.nodes / 1000 * options.agentsPer1000);
+    writeCity(city, dir, agentCount, rng);
+
+    SilenceCout silence;
+    FoodDeliverySimulator *simulator = nullptr;
+
+    Samples load;
+    load.time([&]() { simulator = new FoodDeliverySimulator(dir, options.buildHierarchy, options.buildTable); });
+    load.report("csv_load", city);
+
+    Samples snapshot;
+    for (int i = 0; i < 5; i++)
+    {
+        snapshot.time([&]() { delete Graph::openSnapshot(dir + "/graph.bin"); });
+    }
+    snapshot.report("snapshot_load", city);
+
+    Graph *graph = simulator->getGraph();
+    graph->setTreeCacheBudget(0);
+
+    Samples search;
+    Graph::SearchWorkspace workspace;
+    for (int i = 0; i < options.samples; i++)
+    {
+        int source = rng() % city.nodes;
+        search.time([&]() { graph->dijkstra(source, workspace); });
+    }
+    search.report("single_search", city);
+
+    Samples route;
+    vector<int> path;
+    for (int i = 0; i < options.samples; i++)
+    {
+        int source = city.restaurants[rng() % city.restaurants.size()];
+        int destination = city.deliveries[rng() % city.deliveries.size()];
+        route.time([&]() { graph->shortestRoute(source, destination, path); });
+    }
+    route.report("point_to_point_route", city);
+
+    const char *modeNames[] = {"tree", "bidirectional", "alt"};
+    for (int mode = ROUTE_TREE; mode <= ROUTE_ALT; mode++)
+    {
+        Samples search;
+        for (int i = 0; i < options.samples; i++)
+        {
+            int source = city.restaurants[rng() % city.restaurants.size()];
+            int destination = city.deliveries[rng() % city.deliveries.size()];
+            search.time([&]() { graph->pointToPoint(source, destination, path, (RouteMode)mode); });
+        }
+        search.report(string("route_") + modeNames[mode], city);
+    }
+
+    Samples nearest;
+    for (int i = 0; i < options.samples; i++)
+    {
+        int source = city.restaurants[rng() % city.restaurants.size()];
+        nearest.time([&]() { simulator->findNearestAgent(source); });
+    }
+    nearest.report("nearest_agent", city);
+
+    vector<int> userIds;
+    for (int i = 0; i < (int)city.deliveries.size() && i < 1000; i++)
+    {
+        userIds.push_back(simulator->addUser("Customer " + to_string(i), city.deliveries[i]));
+    }
+
+    graph->setTreeCacheBudget(Graph::DEFAULT_TREE_CACHE_BYTES);
+    Samples tick;
+    for (int t = 0; t < options.ticks; t++)
+    {
+        for (int i = 0; i < options.ordersPerTick; i++)
+        {
+            simulator->placeOrder(userIds[rng() % userIds.size()], 1 + rng() % city.restaurants.size(), 5 + rng() % 6);
+        }
+        tick.time([&]() { simulator->dispatchOrders(); });
+        for (int i = 0; i < options.ordersPerTick; i++)
+        {
+            simulator->undoLastAssignment();
+        }
+    }
+    tick.report("dispatch_tick", city, options.ordersPerTick);
+    printf("{\"case\":\"order_node_pool\",\"generator\":\"%s\",\"nodes\":%d,\"live\":%zu,\"peak\":%zu,\"capacity\":%zu}\n",
+           city.generator.c_str(), city.nodes, NodePool<Order>::liveNodes(), NodePool<Order>::peakNodes(),
+           NodePool<Order>::capacity());
+    fflush(stdout);
+
+    Samples intake;
+    int producers = max(2u, thread::hardware_concurrency());
+    for (int t = 0; t < options.ticks; t++)
+    {
+        intake.time([&]()
+        {
+            atomic<int> finished(0);
+            vector<thread> workers;
+            for (int p = 0; p < producers; p++)
+            {
+                workers.emplace_back([&, p]()
+                {
+                    for (int i = 0; i < options.ordersPerTick; i++)
+                    {
+                        int user = userIds[(p * options.ordersPerTick + i) % userIds.size()];
+                        while (!simulator->submitOrder(user, 1 + i % city.restaurants.size(), 1 + i % 10))
+                        {
+                            this_thread::yield();
+                        }
+                    }
+                    finished++;
+                });
+            }
+            while (finished < producers)
+            {
+                simulator->drainIntake();
+            }
+            for (thread &worker : workers)
+            {
+                worker.join();
+            }
+            simulator->drainIntake();
+        });
+    }
+    intake.report("order_intake", city, producers * options.ordersPerTick);
+
+    delete simulator;
+}
+
+vector<string> splitList(const string &text)
+{
+    vector<string> parts;
+    stringstream ss(text);
+    string part;
+    while (getline(ss, part, ','))
+    {
+        if (!part.empty())
+            parts.push_back(part);
+    }
+    return parts;
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        string value = i + 1 < argc ? argv[i + 1] : "";
+        if (arg == "--generators")
+        {
+            options.generators = splitList(value);
+            i++;
+        }
+        else if (arg == "--sizes")
+        {
+            options.sizes.clear();
+            for (const string &size : splitList(value))
+                options.sizes.push_back(stoi(size));
+            i++;
+        }
+        else if (arg == "--samples")
+        {
+            options.samples = stoi(value);
+            i++;
+        }
+        else if (arg == "--agents-per-1000")
+        {
+            options.agentsPer1000 = stoi(value);
+            i++;
+        }
+        else if (arg == "--orders-per-tick")
+        {
+            options.ordersPerTick = stoi(value);
+            i++;
+        }
+        else if (arg == "--ticks")
+        {
+            options.ticks = stoi(value);
+            i++;
+        }
+        else if (arg == "--data")
+        {
+            options.dataRoot = value;
+            i++;
+        }
+        else if (arg == "--seed")
+        {
+            options.seed = stoul(value);
+            i++;
+        }
+        else if (arg == "--no-hierarchy")
+        {
+            options.buildHierarchy = false;
+        }
+        else if (arg == "--no-table")
+        {
+            options.buildTable = false;
+        }
+        else
+        {
+            fprintf(stderr,
+                    "Usage: %s [--generators grid,geometric,road] [--sizes 1000,10000,...] [--samples N]\n"
+                    "          [--agents-per-1000 N] [--orders-per-tick N] [--ticks N] [--data DIR]\n"
+                    "          [--seed N] [--no-hierarchy] [--no-table]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    makeDirectory(options.dataRoot);
+    mt19937 rng(options.seed);
+    for (const string &generator : options.generators)
+    {
+        for (int size : options.sizes)
+        {
+            City city = generateCity(generator, size, rng);
+            runCity(city, options, rng);
+        }
+    }
+    return 0;
+}
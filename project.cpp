@@ -6,11 +6,134 @@
 #include <vector>
 #include <algorithm>
 #include <cmath>
+#include <queue>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <deque>
+#include <functional>
+#include <condition_variable>
+#include <string_view>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
 const int INF = 999999;
 
+typedef uint32_t StringId;
+
+class StringPool
+{
+private:
+    static const size_t CHUNK_BYTES = 64 * 1024;
+    static const size_t PAGE_SHIFT = 16;
+    static const size_t PAGE_SIZE = (size_t)1 << PAGE_SHIFT;
+    static const size_t MAX_PAGES = (size_t)1 << 16;
+
+    mutex lock;
+    vector<unique_ptr<char[]>> chunks;
+    size_t chunkUsed;
+    size_t chunkSize;
+    unordered_map<string_view, StringId> ids;
+    atomic<string_view *> pages[MAX_PAGES];
+    StringId count;
+
+    StringPool() : chunkUsed(0), chunkSize(0), count(0)
+    {
+        for (size_t i = 0; i < MAX_PAGES; i++)
+        {
+            pages[i].store(nullptr, memory_order_relaxed);
+        }
+        insert(string_view());
+    }
+
+    ~StringPool()
+    {
+        for (size_t i = 0; i < MAX_PAGES; i++)
+        {
+            delete[] pages[i].load(memory_order_relaxed);
+        }
+    }
+
+    static StringPool &instance()
+    {
+        static StringPool pool;
+        return pool;
+    }
+
+    string_view store(string_view text)
+    {
+        if (text.empty())
+        {
+            return string_view();
+        }
+        if (chunkUsed + text.size() > chunkSize)
+        {
+            chunkSize = max(CHUNK_BYTES, text.size());
+            chunks.emplace_back(new char[chunkSize]);
+            chunkUsed = 0;
+        }
+        char *at = chunks.back().get() + chunkUsed;
+        copy(text.begin(), text.end(), at);
+        chunkUsed += text.size();
+        return string_view(at, text.size());
+    }
+
+    StringId insert(string_view text)
+    {
+        StringId id = count;
+        size_t page = id >> PAGE_SHIFT;
+        if (!pages[page].load(memory_order_relaxed))
+        {
+            pages[page].store(new string_view[PAGE_SIZE], memory_order_release);
+        }
+        string_view stored = store(text);
+        pages[page].load(memory_order_relaxed)[id & (PAGE_SIZE - 1)] = stored;
+        ids.emplace(stored, id);
+        count++;
+        return id;
+    }
+
+public:
+    static StringId intern(string_view text)
+    {
+        StringPool &pool = instance();
+        lock_guard<mutex> guard(pool.lock);
+        auto it = pool.ids.find(text);
+        if (it != pool.ids.end())
+        {
+            return it->second;
+        }
+        return pool.insert(text);
+    }
+
+    static string_view view(StringId id)
+    {
+        return instance().pages[id >> PAGE_SHIFT].load(memory_order_acquire)[id & (PAGE_SIZE - 1)];
+    }
+
+    static size_t getCount()
+    {
+        StringPool &pool = instance();
+        lock_guard<mutex> guard(pool.lock);
+        return pool.count;
+    }
+};
+
 template <typename T>
 class Node
 {
@@ -18,36 +141,116 @@ public:
     T data;
     Node *next;
 
-    Node(T val) : data(val), next(nullptr) {}
+    template <typename... Args>
+    explicit Node(Args &&...args) : data(forward<Args>(args)...), next(nullptr) {}
+};
+
+template <typename T>
+class NodePool
+{
+private:
+    static const int SLAB_NODES = 256;
+
+    union Slot
+    {
+        Slot *nextFree;
+        alignas(Node<T>) unsigned char storage[sizeof(Node<T>)];
+    };
+
+    vector<unique_ptr<Slot[]>> slabs;
+    Slot *freeList;
+    size_t live;
+    size_t peak;
+
+    NodePool() : freeList(nullptr), live(0), peak(0) {}
+
+    static NodePool &instance()
+    {
+        static NodePool pool;
+        return pool;
+    }
+
+    void grow()
+    {
+        slabs.emplace_back(new Slot[SLAB_NODES]);
+        Slot *slab = slabs.back().get();
+        for (int i = SLAB_NODES - 1; i >= 0; i--)
+        {
+            slab[i].nextFree = freeList;
+            freeList = &slab[i];
+        }
+    }
+
+public:
+    template <typename... Args>
+    static Node<T> *create(Args &&...args)
+    {
+        NodePool &pool = instance();
+        if (!pool.freeList)
+        {
+            pool.grow();
+        }
+        Slot *slot = pool.freeList;
+        pool.freeList = slot->nextFree;
+        Node<T> *node = new (slot->storage) Node<T>(forward<Args>(args)...);
+        pool.live++;
+        pool.peak = max(pool.peak, pool.live);
+        return node;
+    }
+
+    static void destroy(Node<T> *node)
+    {
+        NodePool &pool = instance();
+        node->~Node<T>();
+        Slot *slot = reinterpret_cast<Slot *>(node);
+        slot->nextFree = pool.freeList;
+        pool.freeList = slot;
+        pool.live--;
+    }
+
+    static size_t liveNodes() { return instance().live; }
+    static size_t peakNodes() { return instance().peak; }
+    static size_t capacity() { return instance().slabs.size() * SLAB_NODES; }
 };
 
 template <typename T>
+class HeapNodeAllocator
+{
+public:
+    template <typename... Args>
+    static Node<T> *create(Args &&...args) { return new Node<T>(forward<Args>(args)...); }
+    static void destroy(Node<T> *node) { delete node; }
+};
+
+template <typename T, typename Allocator = NodePool<T>>
 class LinkedList
 {
 private:
     Node<T> *head;
+    Node<T> *tail;
     int size;
 
 public:
-    LinkedList() : head(nullptr), size(0) {}
+    LinkedList() : head(nullptr), tail(nullptr), size(0) {}
+
+    T *insert(const T &data) { return emplace(data); }
+    T *insert(T &&data) { return emplace(move(data)); }
 
-    void insert(T data)
+    template <typename... Args>
+    T *emplace(Args &&...args)
     {
-        Node<T> *newNode = new Node<T>(data);
+        Node<T> *newNode = Allocator::create(forward<Args>(args)...);
         if (!head)
         {
             head = newNode;
         }
         else
         {
-            Node<T> *temp = head;
-            while (temp->next)
-            {
-                temp = temp->next;
-            }
-            temp->next = newNode;
+            tail->next = newNode;
         }
+        tail = newNode;
         size++;
+        return &newNode->data;
     }
 
     void display()
@@ -84,12 +287,66 @@ public:
         {
             temp = head;
             head = head->next;
-            delete temp;
+            Allocator::destroy(temp);
         }
     }
 };
 
 template <typename T>
+class IdIndex
+{
+private:
+    static const int DENSE_SLACK = 1024;
+
+    vector<T *> dense;
+    unordered_map<int, T *> sparse;
+    int count;
+
+public:
+    IdIndex() : count(0) {}
+
+    void put(int id, T *record)
+    {
+        if (id >= 0 && id < max((int)dense.size(), 2 * count) + DENSE_SLACK)
+        {
+            if (id >= (int)dense.size())
+            {
+                dense.resize(max(id + 1, 2 * (int)dense.size()), nullptr);
+            }
+            if (!dense[id])
+            {
+                count++;
+            }
+            dense[id] = record;
+        }
+        else
+        {
+            if (sparse.find(id) == sparse.end())
+            {
+                count++;
+            }
+            sparse[id] = record;
+        }
+    }
+
+    T *find(int id)
+    {
+        if (id >= 0 && id < (int)dense.size() && dense[id])
+        {
+            return dense[id];
+        }
+        if (sparse.empty())
+        {
+            return nullptr;
+        }
+        auto it = sparse.find(id);
+        return it == sparse.end() ? nullptr : it->second;
+    }
+
+    int getSize() { return count; }
+};
+
+template <typename T, typename Allocator = NodePool<T>>
 class Queue
 {
 private:
@@ -100,9 +357,13 @@ private:
 public:
     Queue() : front(nullptr), rear(nullptr), size(0) {}
 
-    void enqueue(T data)
+    void enqueue(const T &data) { emplace(data); }
+    void enqueue(T &&data) { emplace(move(data)); }
+
+    template <typename... Args>
+    void emplace(Args &&...args)
     {
-        Node<T> *newNode = new Node<T>(data);
+        Node<T> *newNode = Allocator::create(forward<Args>(args)...);
         if (!rear)
         {
             front = rear = newNode;
@@ -122,13 +383,13 @@ public:
             throw runtime_error("Queue is empty");
         }
         Node<T> *temp = front;
-        T data = front->data;
+        T data = move(front->data);
         front = front->next;
         if (!front)
         {
             rear = nullptr;
         }
-        delete temp;
+        Allocator::destroy(temp);
         size--;
         return data;
     }
@@ -136,6 +397,50 @@ public:
     bool isEmpty() { return front == nullptr; }
     int getSize() { return size; }
 
+    class Sweep
+    {
+    private:
+        Queue &queue;
+        Node<T> *previous;
+        Node<T> *current;
+
+    public:
+        Sweep(Queue &q) : queue(q), previous(nullptr), current(q.front) {}
+
+        bool done() { return current == nullptr; }
+        Node<T> *node() { return current; }
+
+        void retain()
+        {
+            previous = current;
+            current = current->next;
+        }
+
+        T take()
+        {
+            Node<T> *temp = current;
+            T data = move(temp->data);
+            current = temp->next;
+            if (previous)
+            {
+                previous->next = current;
+            }
+            else
+            {
+                queue.front = current;
+            }
+            if (queue.rear == temp)
+            {
+                queue.rear = previous;
+            }
+            Allocator::destroy(temp);
+            queue.size--;
+            return data;
+        }
+    };
+
+    Sweep sweep() { return Sweep(*this); }
+
     ~Queue()
     {
         while (!isEmpty())
@@ -146,6 +451,104 @@ public:
 };
 
 template <typename T>
+class RingBuffer
+{
+private:
+    struct Cell
+    {
+        atomic<size_t> sequence;
+        T data;
+    };
+
+    vector<Cell> cells;
+    size_t mask;
+    alignas(64) atomic<size_t> tail;
+    alignas(64) size_t head;
+    alignas(64) atomic<long long> pushed;
+    atomic<long long> rejected;
+    long long drained;
+
+public:
+    RingBuffer(size_t capacity) : tail(0), head(0), pushed(0), rejected(0), drained(0)
+    {
+        size_t size = 1;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        cells = vector<Cell>(size);
+        mask = size - 1;
+        for (size_t i = 0; i < size; i++)
+        {
+            cells[i].sequence.store(i, memory_order_relaxed);
+        }
+    }
+
+    bool tryPush(T data)
+    {
+        size_t position = tail.load(memory_order_relaxed);
+        while (true)
+        {
+            Cell &cell = cells[position & mask];
+            size_t sequence = cell.sequence.load(memory_order_acquire);
+            long long lag = (long long)sequence - (long long)position;
+            if (lag == 0)
+            {
+                if (tail.compare_exchange_weak(position, position + 1, memory_order_relaxed))
+                {
+                    cell.data = move(data);
+                    cell.sequence.store(position + 1, memory_order_release);
+                    pushed.fetch_add(1, memory_order_relaxed);
+                    return true;
+                }
+            }
+            else if (lag < 0)
+            {
+                rejected.fetch_add(1, memory_order_relaxed);
+                return false;
+            }
+            else
+            {
+                position = tail.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T &out)
+    {
+        Cell &cell = cells[head & mask];
+        if (cell.sequence.load(memory_order_acquire) != head + 1)
+        {
+            return false;
+        }
+        out = move(cell.data);
+        cell.sequence.store(head + mask + 1, memory_order_release);
+        head++;
+        drained++;
+        return true;
+    }
+
+    template <typename Sink>
+    int drain(Sink sink, int limit)
+    {
+        int count = 0;
+        T item;
+        while (count < limit && tryPop(item))
+        {
+            sink(move(item));
+            count++;
+        }
+        return count;
+    }
+
+    int getCapacity() { return cells.size(); }
+    int approxSize() { return (int)(tail.load(memory_order_relaxed) - head); }
+    long long getPushed() { return pushed.load(memory_order_relaxed); }
+    long long getRejected() { return rejected.load(memory_order_relaxed); }
+    long long getDrained() { return drained; }
+};
+
+template <typename T, typename Allocator = NodePool<T>>
 class Stack
 {
 private:
@@ -155,9 +558,13 @@ private:
 public:
     Stack() : top(nullptr), size(0) {}
 
-    void push(T data)
+    void push(const T &data) { emplace(data); }
+    void push(T &&data) { emplace(move(data)); }
+
+    template <typename... Args>
+    void emplace(Args &&...args)
     {
-        Node<T> *newNode = new Node<T>(data);
+        Node<T> *newNode = Allocator::create(forward<Args>(args)...);
         newNode->next = top;
         top = newNode;
         size++;
@@ -170,9 +577,9 @@ public:
             throw runtime_error("Stack is empty");
         }
         Node<T> *temp = top;
-        T data = top->data;
+        T data = move(top->data);
         top = top->next;
-        delete temp;
+        Allocator::destroy(temp);
         size--;
         return data;
     }
@@ -193,462 +600,3263 @@ template <typename T>
 class PriorityQueue
 {
 private:
-    struct PQNode
+    static const int ARITY = 4;
+    static const int SLOT_BITS = 32;
+
+    struct Entry
     {
         T data;
         int priority;
-        PQNode *next;
-
-        PQNode(T d, int p) : data(d), priority(p), next(nullptr) {}
+        long long sequence;
+        int handle;
     };
 
-    PQNode *head;
-    int size;
+    vector<Entry> heap;
+    vector<int> position;
+    vector<int> generation;
+    vector<int> freeHandles;
+    long long nextSequence;
 
-public:
-    PriorityQueue() : head(nullptr), size(0) {}
+    // Handles carry the slot's generation, so a handle kept after its entry left the queue never matches the slot's next owner
+    int slotOf(long long handle)
+    {
+        if (handle < 0)
+            return -1;
+        int slot = (int)(handle & ((1LL << SLOT_BITS) - 1));
+        if (slot >= (int)position.size() || position[slot] == -1 || generation[slot] != (int)(handle >> SLOT_BITS))
+            return -1;
+        return slot;
+    }
+
+    static bool before(const Entry &a, const Entry &b)
+    {
+        return a.priority > b.priority || (a.priority == b.priority && a.sequence < b.sequence);
+    }
 
-    void enqueue(T data, int priority)
+    void place(int i, Entry &&e)
     {
-        PQNode *newNode = new PQNode(data, priority);
+        position[e.handle] = i;
+        heap[i] = move(e);
+    }
 
-        if (!head || priority > head->priority)
+    void siftUp(int i)
+    {
+        Entry e = move(heap[i]);
+        while (i > 0)
         {
-            newNode->next = head;
-            head = newNode;
+            int p = (i - 1) / ARITY;
+            if (!before(e, heap[p]))
+                break;
+            place(i, move(heap[p]));
+            i = p;
         }
-        else
+        place(i, move(e));
+    }
+
+    void siftDown(int i)
+    {
+        Entry e = move(heap[i]);
+        int n = heap.size();
+        while (true)
         {
-            PQNode *temp = head;
-            while (temp->next && temp->next->priority >= priority)
+            int first = i * ARITY + 1;
+            if (first >= n)
+                break;
+            int best = first;
+            for (int c = first + 1; c < first + ARITY && c < n; c++)
             {
-                temp = temp->next;
+                if (before(heap[c], heap[best]))
+                    best = c;
             }
-            newNode->next = temp->next;
-            temp->next = newNode;
+            if (!before(heap[best], e))
+                break;
+            place(i, move(heap[best]));
+            i = best;
         }
-        size++;
+        place(i, move(e));
+    }
+
+    Entry takeAt(int i)
+    {
+        Entry taken = move(heap[i]);
+        position[taken.handle] = -1;
+        generation[taken.handle] = (generation[taken.handle] + 1) & numeric_limits<int>::max();
+        freeHandles.push_back(taken.handle);
+        Entry last = move(heap.back());
+        heap.pop_back();
+        if (i < (int)heap.size())
+        {
+            place(i, move(last));
+            if (i > 0 && before(heap[i], heap[(i - 1) / ARITY]))
+                siftUp(i);
+            else
+                siftDown(i);
+        }
+        return taken;
+    }
+
+public:
+    PriorityQueue() : nextSequence(0) {}
+
+    long long enqueue(const T &data, int priority) { return emplace(priority, data); }
+    long long enqueue(T &&data, int priority) { return emplace(priority, move(data)); }
+
+    template <typename... Args>
+    long long emplace(int priority, Args &&...args)
+    {
+        int handle;
+        if (!freeHandles.empty())
+        {
+            handle = freeHandles.back();
+            freeHandles.pop_back();
+            position[handle] = heap.size();
+        }
+        else
+        {
+            handle = position.size();
+            position.push_back(heap.size());
+            generation.push_back(0);
+        }
+        heap.push_back(Entry{T(forward<Args>(args)...), priority, nextSequence++, handle});
+        siftUp(heap.size() - 1);
+        return (long long)generation[handle] << SLOT_BITS | handle;
     }
 
     T dequeue()
     {
-        if (!head)
+        if (heap.empty())
         {
             throw runtime_error("Priority Queue is empty");
         }
-        PQNode *temp = head;
-        T data = head->data;
-        head = head->next;
-        delete temp;
-        size--;
-        return data;
+        return move(takeAt(0).data);
     }
 
-    bool isEmpty() { return head == nullptr; }
-    int getSize() { return size; }
+    bool contains(long long handle)
+    {
+        return slotOf(handle) != -1;
+    }
 
-    ~PriorityQueue()
+    bool changePriority(long long handle, int priority)
     {
-        while (!isEmpty())
+        int slot = slotOf(handle);
+        if (slot == -1)
         {
-            dequeue();
+            return false;
+        }
+        int i = position[slot];
+        int old = heap[i].priority;
+        heap[i].priority = priority;
+        if (priority > old)
+            siftUp(i);
+        else
+            siftDown(i);
+        return true;
+    }
+
+    bool remove(long long handle)
+    {
+        int slot = slotOf(handle);
+        if (slot == -1)
+        {
+            return false;
         }
+        takeAt(position[slot]);
+        return true;
     }
+
+    bool isEmpty() { return heap.empty(); }
+    int getSize() { return heap.size(); }
 };
 
 struct Restaurant
 {
     int id;
-    string name;
+    StringId name;
     int nodeId;
 
-    Restaurant() : id(0), name(""), nodeId(0) {}
-    Restaurant(int i, string n, int nid) : id(i), name(n), nodeId(nid) {}
+    Restaurant() : id(0), name(0), nodeId(0) {}
+    Restaurant(int i, string_view n, int nid) : id(i), name(StringPool::intern(n)), nodeId(nid) {}
 
     friend ostream &operator<<(ostream &os, const Restaurant &r)
     {
-        os << "Restaurant ID: " << r.id << ", Name: " << r.name << ", Node: " << r.nodeId;
+        os << "Restaurant ID: " << r.id << ", Name: " << StringPool::view(r.name) << ", Node: " << r.nodeId;
         return os;
     }
 };
 
-class BSTNode
-{
-public:
-    Restaurant data;
-    BSTNode *left;
-    BSTNode *right;
-
-    BSTNode(Restaurant r) : data(r), left(nullptr), right(nullptr) {}
-};
-
-class BST
+class RestaurantIndex
 {
 private:
-    BSTNode *root;
+    vector<Restaurant> byName;
+    IdIndex<Restaurant> byId;
 
-    BSTNode *insertHelper(BSTNode *node, Restaurant r)
+    static bool nameLess(const Restaurant &a, const Restaurant &b)
     {
-        if (!node)
-        {
-            return new BSTNode(r);
-        }
-
-        if (r.name < node->data.name)
-        {
-            node->left = insertHelper(node->left, r);
-        }
-        else
-        {
-            node->right = insertHelper(node->right, r);
-        }
-        return node;
+        return StringPool::view(a.name) < StringPool::view(b.name);
     }
 
-    void inorderHelper(BSTNode *node)
+    void reindex()
     {
-        if (node)
+        byId = IdIndex<Restaurant>();
+        for (Restaurant &r : byName)
         {
-            inorderHelper(node->left);
-            cout << node->data << endl;
-            inorderHelper(node->right);
+            if (!byId.find(r.id))
+            {
+                byId.put(r.id, &r);
+            }
         }
     }
 
-    Restaurant *searchHelper(BSTNode *node, string name)
+    int lowerBound(string_view name)
     {
-        if (!node)
-        {
-            return nullptr;
-        }
-
-        if (name == node->data.name)
-        {
-            return &(node->data);
-        }
-        else if (name < node->data.name)
-        {
-            return searchHelper(node->left, name);
-        }
-        else
+        int lo = 0, hi = byName.size();
+        while (lo < hi)
         {
-            return searchHelper(node->right, name);
+            int mid = (lo + hi) / 2;
+            if (StringPool::view(byName[mid].name) < name)
+                lo = mid + 1;
+            else
+                hi = mid;
         }
+        return lo;
     }
 
-    void destroyTree(BSTNode *node)
+public:
+    void load(vector<Restaurant> restaurants)
     {
-        if (node)
+        if (!is_sorted(restaurants.begin(), restaurants.end(), nameLess))
         {
-            destroyTree(node->left);
-            destroyTree(node->right);
-            delete node;
+            stable_sort(restaurants.begin(), restaurants.end(), nameLess);
         }
+        byName = move(restaurants);
+        reindex();
     }
 
-public:
-    BST() : root(nullptr) {}
-
     void insert(Restaurant r)
     {
-        root = insertHelper(root, r);
+        auto at = upper_bound(byName.begin(), byName.end(), r, nameLess);
+        byName.insert(at, move(r));
+        reindex();
     }
 
     void inorderTraversal()
     {
-        inorderHelper(root);
+        for (const Restaurant &r : byName)
+        {
+            cout << r << endl;
+        }
     }
 
-    Restaurant *search(string name)
+    Restaurant *search(string_view name)
     {
-        return searchHelper(root, name);
+        int i = lowerBound(name);
+        if (i < (int)byName.size() && StringPool::view(byName[i].name) == name)
+        {
+            return &byName[i];
+        }
+        return nullptr;
+    }
+
+    Restaurant *findById(int id)
+    {
+        return byId.find(id);
+    }
+
+    vector<Restaurant *> withPrefix(string_view prefix)
+    {
+        vector<Restaurant *> result;
+        for (int i = lowerBound(prefix); i < (int)byName.size(); i++)
+        {
+            if (StringPool::view(byName[i].name).substr(0, prefix.size()) != prefix)
+                break;
+            result.push_back(&byName[i]);
+        }
+        return result;
+    }
+
+    vector<Restaurant *> inRange(string_view from, string_view to)
+    {
+        vector<Restaurant *> result;
+        for (int i = lowerBound(from); i < (int)byName.size() && StringPool::view(byName[i].name) < to; i++)
+        {
+            result.push_back(&byName[i]);
+        }
+        return result;
+    }
+
+    Restaurant &at(int i) { return byName[i]; }
+    int getSize() { return byName.size(); }
+};
+
+class IndexedMinHeap
+{
+private:
+    struct Entry
+    {
+        int key;
+        int id;
+    };
+
+    vector<Entry> heap;
+    vector<int> position;
+
+    static bool before(const Entry &a, const Entry &b)
+    {
+        return a.key < b.key || (a.key == b.key && a.id < b.id);
+    }
+
+    void place(int i, Entry e)
+    {
+        heap[i] = e;
+        position[e.id] = i;
+    }
+
+    void siftUp(int i)
+    {
+        Entry e = heap[i];
+        while (i > 0)
+        {
+            int p = (i - 1) / 2;
+            if (!before(e, heap[p]))
+                break;
+            place(i, heap[p]);
+            i = p;
+        }
+        place(i, e);
+    }
+
+    void siftDown(int i)
+    {
+        Entry e = heap[i];
+        int n = heap.size();
+        while (true)
+        {
+            int c = 2 * i + 1;
+            if (c >= n)
+                break;
+            if (c + 1 < n && before(heap[c + 1], heap[c]))
+                c++;
+            if (!before(heap[c], e))
+                break;
+            place(i, heap[c]);
+            i = c;
+        }
+        place(i, e);
+    }
+
+public:
+    IndexedMinHeap(int capacity) : position(capacity, -1) {}
+
+    void push(int id, int key)
+    {
+        if (position[id] == -1)
+        {
+            heap.push_back(Entry{key, id});
+            position[id] = heap.size() - 1;
+            siftUp(heap.size() - 1);
+        }
+        else if (key < heap[position[id]].key)
+        {
+            heap[position[id]].key = key;
+            siftUp(position[id]);
+        }
+    }
+
+    int pop()
+    {
+        int id = heap[0].id;
+        position[id] = -1;
+        Entry last = heap.back();
+        heap.pop_back();
+        if (!heap.empty())
+        {
+            place(0, last);
+            siftDown(0);
+        }
+        return id;
+    }
+
+    int minKey() { return heap[0].key; }
+
+    void clear(int capacity)
+    {
+        for (const Entry &e : heap)
+        {
+            position[e.id] = -1;
+        }
+        heap.clear();
+        if ((int)position.size() < capacity)
+        {
+            position.resize(capacity, -1);
+        }
+    }
+
+    bool isEmpty() { return heap.empty(); }
+    int getSize() { return heap.size(); }
+};
+
+class DurableFile
+{
+private:
+    int fd;
+
+public:
+    DurableFile() : fd(-1) {}
+    ~DurableFile() { close(); }
+
+    bool open(const string &path, bool truncate)
+    {
+        close();
+#ifdef _WIN32
+        fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_BINARY | (truncate ? _O_TRUNC : _O_APPEND),
+                   _S_IREAD | _S_IWRITE);
+#else
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | (truncate ? O_TRUNC : O_APPEND), 0644);
+#endif
+        return fd != -1;
+    }
+
+    bool write(const string &data) { return write(data.data(), data.size()); }
+
+    bool write(const char *data, size_t size)
+    {
+        size_t done = 0;
+        while (done < size)
+        {
+#ifdef _WIN32
+            int n = _write(fd, data + done, (unsigned)(size - done));
+#else
+            ssize_t n = ::write(fd, data + done, size - done);
+#endif
+            if (n <= 0)
+            {
+                return false;
+            }
+            done += n;
+        }
+        return true;
+    }
+
+    bool sync()
+    {
+#ifdef _WIN32
+        return _commit(fd) == 0;
+#else
+        return fsync(fd) == 0;
+#endif
+    }
+
+    void close()
+    {
+        if (fd != -1)
+        {
+#ifdef _WIN32
+            _close(fd);
+#else
+            ::close(fd);
+#endif
+            fd = -1;
+        }
+    }
+
+    bool isOpen() { return fd != -1; }
+
+    static bool replace(const string &from, const string &to)
+    {
+#ifdef _WIN32
+        remove(to.c_str());
+#endif
+        return rename(from.c_str(), to.c_str()) == 0 && syncDirectory(to);
+    }
+
+    static bool syncDirectory(const string &path)
+    {
+#ifdef _WIN32
+        return true;
+#else
+        size_t slash = path.find_last_of('/');
+        string directory = slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+        int fd = ::open(directory.c_str(), O_RDONLY);
+        if (fd == -1)
+        {
+            return false;
+        }
+        bool ok = fsync(fd) == 0;
+        ::close(fd);
+        return ok;
+#endif
+    }
+
+    static bool exists(const string &path)
+    {
+        struct stat info;
+        return stat(path.c_str(), &info) == 0;
+    }
+
+    static long long sizeOf(const string &path)
+    {
+        struct stat info;
+        return stat(path.c_str(), &info) == 0 ? (long long)info.st_size : -1;
+    }
+
+    static long long modifiedAt(const string &path)
+    {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)
+        {
+            return -1;
+        }
+#ifdef _WIN32
+        return (long long)info.st_mtime * 1000000000LL;
+#else
+        return (long long)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+#endif
+    }
+};
+
+class MappedFile
+{
+private:
+    const char *data;
+    size_t size;
+    vector<char> fallback;
+    bool mapped;
+
+public:
+    MappedFile() : data(nullptr), size(0), mapped(false) {}
+    ~MappedFile() { close(); }
+
+    bool open(const string &path, bool sequential = true)
+    {
+        close();
+#ifdef _WIN32
+        ifstream file(path, ios::binary);
+        if (!file)
+        {
+            return false;
+        }
+        fallback.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        data = fallback.data();
+        size = fallback.size();
+        return true;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1)
+        {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        size = info.st_size;
+        if (size > 0)
+        {
+            void *view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view == MAP_FAILED)
+            {
+                ::close(fd);
+                return false;
+            }
+            if (sequential)
+            {
+                madvise(view, size, MADV_SEQUENTIAL);
+            }
+            data = (const char *)view;
+            mapped = true;
+        }
+        ::close(fd);
+        return true;
+#endif
+    }
+
+    void close()
+    {
+#ifndef _WIN32
+        if (mapped)
+        {
+            munmap((void *)data, size);
+        }
+#endif
+        fallback.clear();
+        data = nullptr;
+        size = 0;
+        mapped = false;
+    }
+
+    string_view view() const { return string_view(data, size); }
+};
+
+enum RouteMode
+{
+    ROUTE_TREE,
+    ROUTE_BIDIRECTIONAL,
+    ROUTE_ALT
+};
+
+struct Edge
+{
+    int src;
+    int dest;
+    int weight;
+
+    Edge(int s, int d, int w) : src(s), dest(d), weight(w) {}
+};
+
+struct Arc
+{
+    int dest;
+    int weight;
+};
+
+struct NodeInfo
+{
+    int id;
+    uint32_t name;
+    uint32_t type;
+
+    NodeInfo() : id(0), name(0), type(0) {}
+    NodeInfo(int i, uint32_t n, uint32_t t) : id(i), name(n), type(t) {}
+};
+
+template <typename T>
+class FlatArray
+{
+private:
+    vector<T> owned;
+    const T *base;
+    size_t count;
+    bool borrowed;
+
+    void own()
+    {
+        if (borrowed)
+        {
+            owned.assign(base, base + count);
+            borrowed = false;
+        }
+    }
+
+    void sync()
+    {
+        base = owned.data();
+        count = owned.size();
+    }
+
+public:
+    FlatArray() : base(nullptr), count(0), borrowed(false) {}
+
+    FlatArray(const FlatArray &) = delete;
+    FlatArray &operator=(const FlatArray &) = delete;
+
+    void assign(vector<T> &&values)
+    {
+        owned = move(values);
+        borrowed = false;
+        sync();
+    }
+
+    void borrow(const T *values, size_t size)
+    {
+        vector<T>().swap(owned);
+        base = values;
+        count = size;
+        borrowed = true;
+    }
+
+    void push_back(const T &value)
+    {
+        own();
+        owned.push_back(value);
+        sync();
+    }
+
+    void append(const T *values, size_t size)
+    {
+        own();
+        owned.insert(owned.end(), values, values + size);
+        sync();
+    }
+
+    T &at(size_t i)
+    {
+        own();
+        sync();
+        return owned[i];
+    }
+
+    const T &operator[](size_t i) const { return base[i]; }
+    const T *data() const { return base; }
+    const T *begin() const { return base; }
+    const T *end() const { return base + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool isBorrowed() const { return borrowed; }
+};
+
+class StringTable
+{
+private:
+    FlatArray<uint32_t> offsets;
+    FlatArray<char> bytes;
+    unordered_map<string, uint32_t> lookup;
+
+public:
+    StringTable() { clear(); }
+
+    void clear()
+    {
+        offsets.assign(vector<uint32_t>(1, 0));
+        bytes.assign(vector<char>());
+        lookup.clear();
+        intern("");
+    }
+
+    uint32_t intern(string_view text)
+    {
+        if (lookup.size() < getCount())
+        {
+            for (uint32_t i = 0; i < getCount(); i++)
+            {
+                lookup.emplace(string(view(i)), i);
+            }
+        }
+
+        auto found = lookup.find(string(text));
+        if (found != lookup.end())
+        {
+            return found->second;
+        }
+
+        uint32_t id = getCount();
+        bytes.append(text.data(), text.size());
+        offsets.push_back(bytes.size());
+        lookup.emplace(string(text), id);
+        return id;
+    }
+
+    void borrow(const uint32_t *offsetData, size_t stringCount, const char *byteData, size_t byteCount)
+    {
+        offsets.borrow(offsetData, stringCount + 1);
+        bytes.borrow(byteData, byteCount);
+        lookup.clear();
+    }
+
+    string_view view(uint32_t id) const
+    {
+        return string_view(bytes.data() + offsets[id], offsets[id + 1] - offsets[id]);
+    }
+
+    uint32_t getCount() const { return offsets.size() - 1; }
+    const FlatArray<uint32_t> &getOffsets() const { return offsets; }
+    const FlatArray<char> &getBytes() const { return bytes; }
+};
+
+enum SnapshotSection
+{
+    SNAPSHOT_NODES,
+    SNAPSHOT_EDGES,
+    SNAPSHOT_EDGE_STREETS,
+    SNAPSHOT_ARC_OFFSETS,
+    SNAPSHOT_ARCS,
+    SNAPSHOT_ARC_EDGES,
+    SNAPSHOT_STRING_OFFSETS,
+    SNAPSHOT_STRING_BYTES,
+    SNAPSHOT_SECTION_COUNT
+};
+
+struct GraphSnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t checksum;
+    uint64_t vertices;
+    uint64_t edgeCount;
+    uint64_t stringCount;
+    uint64_t offset[SNAPSHOT_SECTION_COUNT];
+    uint64_t length[SNAPSHOT_SECTION_COUNT];
+};
+
+const char GRAPH_SNAPSHOT_MAGIC[8] = {'F', 'D', 'S', 'G', 'R', 'A', 'P', 'H'};
+const uint32_t GRAPH_SNAPSHOT_VERSION = 1;
+const uint32_t GRAPH_SNAPSHOT_BYTE_ORDER = 0x01020304;
+const size_t GRAPH_SNAPSHOT_ALIGN = 64;
+
+uint64_t snapshotChecksum(const char *data, size_t size, uint64_t hash)
+{
+    const uint64_t prime = 1099511628211ULL;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * prime;
+    }
+    for (; i < size; i++)
+    {
+        hash = (hash ^ (unsigned char)data[i]) * prime;
+    }
+    return hash;
+}
+
+class ContractionHierarchy
+{
+private:
+    struct Shortcut
+    {
+        int to;
+        int weight;
+        int middle;
+    };
+
+    struct UpArc
+    {
+        int dest;
+        int weight;
+        int middle;
+    };
+
+    struct QueryState
+    {
+        vector<int> dist[2];
+        vector<int> parentArc[2];
+        vector<int> parentNode[2];
+        vector<int> touched;
+    };
+
+    int vertices;
+    vector<int> rank;
+    vector<int> upOffsets;
+    vector<UpArc> upArcs;
+
+    vector<vector<Shortcut>> work;
+    vector<bool> contracted;
+    vector<int> witnessDist;
+    vector<int> witnessTouched;
+
+    static const int WITNESS_SETTLE_LIMIT = 200;
+
+    void addOrImprove(int u, int v, int weight, int middle)
+    {
+        for (Shortcut &s : work[u])
+        {
+            if (s.to == v)
+            {
+                if (weight < s.weight)
+                {
+                    s.weight = weight;
+                    s.middle = middle;
+                }
+                return;
+            }
+        }
+        work[u].push_back(Shortcut{v, weight, middle});
+    }
+
+    void witnessSearch(int source, int skip, int limit)
+    {
+        for (int v : witnessTouched)
+        {
+            witnessDist[v] = INF;
+        }
+        witnessTouched.clear();
+
+        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+        witnessDist[source] = 0;
+        witnessTouched.push_back(source);
+        pq.push(make_pair(0, source));
+
+        int settled = 0;
+        while (!pq.empty() && settled < WITNESS_SETTLE_LIMIT)
+        {
+            int d = pq.top().first;
+            int u = pq.top().second;
+            pq.pop();
+            if (d > witnessDist[u])
+                continue;
+            if (d > limit)
+                break;
+            settled++;
+
+            for (const Shortcut &s : work[u])
+            {
+                if (s.to == skip)
+                    continue;
+                if (d + s.weight < witnessDist[s.to])
+                {
+                    if (witnessDist[s.to] == INF)
+                    {
+                        witnessTouched.push_back(s.to);
+                    }
+                    witnessDist[s.to] = d + s.weight;
+                    pq.push(make_pair(witnessDist[s.to], s.to));
+                }
+            }
+        }
+    }
+
+    int contract(int v, bool simulate)
+    {
+        const vector<Shortcut> &neighbours = work[v];
+
+        int added = 0;
+        for (int i = 0; i + 1 < (int)neighbours.size(); i++)
+        {
+            int maxTarget = 0;
+            for (int j = i + 1; j < (int)neighbours.size(); j++)
+            {
+                maxTarget = max(maxTarget, neighbours[i].weight + neighbours[j].weight);
+            }
+
+            witnessSearch(neighbours[i].to, v, maxTarget);
+
+            for (int j = i + 1; j < (int)neighbours.size(); j++)
+            {
+                int u = neighbours[i].to;
+                int w = neighbours[j].to;
+                int viaV = neighbours[i].weight + neighbours[j].weight;
+                if (u == w || witnessDist[w] <= viaV)
+                    continue;
+
+                added++;
+                if (!simulate)
+                {
+                    addOrImprove(u, w, viaV, v);
+                    addOrImprove(w, u, viaV, v);
+                }
+            }
+        }
+        return added;
+    }
+
+    int priorityOf(int v, const vector<int> &contractedNeighbours, const vector<int> &level)
+    {
+        int degree = work[v].size();
+        return 2 * (contract(v, true) - degree) + contractedNeighbours[v] + level[v];
+    }
+
+    int findUpArc(int low, int high)
+    {
+        for (int a = upOffsets[low]; a < upOffsets[low + 1]; a++)
+        {
+            if (upArcs[a].dest == high)
+            {
+                return a;
+            }
+        }
+        return -1;
+    }
+
+    void unpackEdge(int from, int to, int middle, vector<int> &path)
+    {
+        if (middle == -1)
+        {
+            path.push_back(to);
+            return;
+        }
+
+        vector<pair<int, int>> pending;
+        pending.push_back(make_pair(middle, to));
+        pending.push_back(make_pair(from, middle));
+
+        while (!pending.empty())
+        {
+            int a = pending.back().first;
+            int b = pending.back().second;
+            pending.pop_back();
+
+            int arc = rank[a] < rank[b] ? findUpArc(a, b) : findUpArc(b, a);
+            int m = upArcs[arc].middle;
+            if (m == -1)
+            {
+                path.push_back(b);
+            }
+            else
+            {
+                pending.push_back(make_pair(m, b));
+                pending.push_back(make_pair(a, m));
+            }
+        }
+    }
+
+public:
+    ContractionHierarchy(int v, const FlatArray<int> &arcOffsets, const FlatArray<Arc> &arcs)
+        : vertices(v), rank(v, -1), work(v), contracted(v, false), witnessDist(v, INF)
+    {
+        for (int u = 0; u < vertices; u++)
+        {
+            for (int a = arcOffsets[u]; a < arcOffsets[u + 1]; a++)
+            {
+                if (arcs[a].dest != u)
+                {
+                    addOrImprove(u, arcs[a].dest, arcs[a].weight, -1);
+                }
+            }
+        }
+
+        vector<int> contractedNeighbours(vertices, 0);
+        vector<int> level(vertices, 0);
+        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> order;
+        for (int u = 0; u < vertices; u++)
+        {
+            order.push(make_pair(priorityOf(u, contractedNeighbours, level), u));
+        }
+
+        int nextRank = 0;
+        while (!order.empty())
+        {
+            int u = order.top().second;
+            order.pop();
+            if (contracted[u])
+                continue;
+
+            int current = priorityOf(u, contractedNeighbours, level);
+            if (!order.empty() && current > order.top().first)
+            {
+                order.push(make_pair(current, u));
+                continue;
+            }
+
+            contract(u, false);
+            contracted[u] = true;
+            rank[u] = nextRank++;
+            for (const Shortcut &s : work[u])
+            {
+                contractedNeighbours[s.to]++;
+                level[s.to] = max(level[s.to], level[u] + 1);
+
+                vector<Shortcut> &back = work[s.to];
+                for (int i = 0; i < (int)back.size(); i++)
+                {
+                    if (back[i].to == u)
+                    {
+                        back[i] = back.back();
+                        back.pop_back();
+                        break;
+                    }
+                }
+            }
+        }
+
+        upOffsets.assign(vertices + 1, 0);
+        for (int u = 0; u < vertices; u++)
+        {
+            for (const Shortcut &s : work[u])
+            {
+                if (rank[s.to] > rank[u])
+                    upOffsets[u + 1]++;
+            }
+        }
+        for (int u = 0; u < vertices; u++)
+        {
+            upOffsets[u + 1] += upOffsets[u];
+        }
+        upArcs.resize(upOffsets[vertices]);
+        for (int u = 0; u < vertices; u++)
+        {
+            int a = upOffsets[u];
+            for (const Shortcut &s : work[u])
+            {
+                if (rank[s.to] > rank[u])
+                    upArcs[a++] = UpArc{s.to, s.weight, s.middle};
+            }
+        }
+
+        work.clear();
+        work.shrink_to_fit();
+        contracted.clear();
+        witnessDist.clear();
+        witnessTouched.clear();
+    }
+
+    int getShortcutCount()
+    {
+        int shortcuts = 0;
+        for (const UpArc &a : upArcs)
+        {
+            if (a.middle != -1)
+                shortcuts++;
+        }
+        return shortcuts;
+    }
+
+    int query(int source, int destination, vector<int> &path)
+    {
+        static thread_local QueryState state;
+        for (int side = 0; side < 2; side++)
+        {
+            if ((int)state.dist[side].size() < vertices)
+            {
+                state.dist[side].assign(vertices, INF);
+                state.parentArc[side].assign(vertices, -1);
+                state.parentNode[side].assign(vertices, -1);
+            }
+        }
+        for (int v : state.touched)
+        {
+            state.dist[0][v] = state.dist[1][v] = INF;
+        }
+        state.touched.clear();
+
+        typedef priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> MinQueue;
+        MinQueue pq[2];
+        int start[2] = {source, destination};
+        for (int side = 0; side < 2; side++)
+        {
+            state.dist[side][start[side]] = 0;
+            state.parentArc[side][start[side]] = -1;
+            state.parentNode[side][start[side]] = -1;
+            pq[side].push(make_pair(0, start[side]));
+        }
+        state.touched.push_back(source);
+        state.touched.push_back(destination);
+
+        int best = INF;
+        int meet = -1;
+        bool active[2] = {true, true};
+        int side = 0;
+
+        while (active[0] || active[1])
+        {
+            if (!active[side])
+            {
+                side = 1 - side;
+            }
+            if (pq[side].empty() || pq[side].top().first >= best)
+            {
+                active[side] = false;
+                side = 1 - side;
+                continue;
+            }
+
+            int d = pq[side].top().first;
+            int u = pq[side].top().second;
+            pq[side].pop();
+
+            if (d == state.dist[side][u])
+            {
+                if (state.dist[1 - side][u] != INF && d + state.dist[1 - side][u] < best)
+                {
+                    best = d + state.dist[1 - side][u];
+                    meet = u;
+                }
+
+                bool stalled = false;
+                for (int a = upOffsets[u]; a < upOffsets[u + 1] && !stalled; a++)
+                {
+                    stalled = state.dist[side][upArcs[a].dest] + upArcs[a].weight < d;
+                }
+
+                for (int a = upOffsets[u]; a < upOffsets[u + 1] && !stalled; a++)
+                {
+                    int v = upArcs[a].dest;
+                    int nd = d + upArcs[a].weight;
+                    if (nd < state.dist[side][v])
+                    {
+                        if (state.dist[0][v] == INF && state.dist[1][v] == INF)
+                        {
+                            state.touched.push_back(v);
+                        }
+                        state.dist[side][v] = nd;
+                        state.parentArc[side][v] = a;
+                        state.parentNode[side][v] = u;
+                        pq[side].push(make_pair(nd, v));
+                    }
+                }
+            }
+            side = 1 - side;
+        }
+
+        path.clear();
+        if (meet == -1)
+        {
+            path.push_back(destination);
+            return INF;
+        }
+
+        vector<int> upward;
+        for (int v = meet; v != source; v = state.parentNode[0][v])
+        {
+            upward.push_back(v);
+        }
+        path.push_back(source);
+        for (int i = upward.size() - 1; i >= 0; i--)
+        {
+            int v = upward[i];
+            unpackEdge(state.parentNode[0][v], v, upArcs[state.parentArc[0][v]].middle, path);
+        }
+        for (int v = meet; v != destination; v = state.parentNode[1][v])
+        {
+            unpackEdge(v, state.parentNode[1][v], upArcs[state.parentArc[1][v]].middle, path);
+        }
+        return best;
+    }
+};
+
+class DistanceTable
+{
+private:
+    static constexpr uint16_t NO_HOP = 0xFFFF;
+    static constexpr long long MAX_HOP_ENTRIES = 64LL * 1024 * 1024;
+    static constexpr long long MAX_ENTRIES = 16LL * 1024 * 1024;
+    static constexpr long long MAX_BUILD_SETTLES = 256LL * 1024 * 1024;
+
+    int vertices;
+    vector<int> rowOf;
+    vector<int> colOf;
+    int rows;
+    int cols;
+
+    bool wide;
+    vector<uint32_t> dist32;
+    vector<uint16_t> dist16;
+    vector<uint16_t> hopArc;
+
+public:
+    // One full Dijkstra per target, so the build cost is bounded along with the matrix size
+    static bool fits(int vertices, int rows, int cols)
+    {
+        return (long long)rows * cols <= MAX_ENTRIES && (long long)cols * vertices <= MAX_BUILD_SETTLES;
+    }
+
+    DistanceTable(int v, const vector<int> &sources, const vector<int> &targets)
+        : vertices(v), rowOf(v, -1), colOf(v, -1), rows(sources.size()), cols(targets.size()), wide(true)
+    {
+        for (int r = 0; r < rows; r++)
+        {
+            rowOf[sources[r]] = r;
+        }
+        for (int c = 0; c < cols; c++)
+        {
+            colOf[targets[c]] = c;
+        }
+        dist32.assign((size_t)rows * cols, INF);
+        if ((long long)cols * vertices <= MAX_HOP_ENTRIES)
+        {
+            hopArc.assign((size_t)cols * vertices, NO_HOP);
+        }
+    }
+
+    void fillColumn(int col, const vector<int> &sources, const vector<int> &dist, const vector<int> &parent,
+                    const FlatArray<int> &arcOffsets, const FlatArray<Arc> &arcs)
+    {
+        for (int r = 0; r < rows; r++)
+        {
+            dist32[(size_t)col * rows + r] = dist[sources[r]];
+        }
+
+        if (hopArc.empty())
+            return;
+
+        uint16_t *hops = &hopArc[(size_t)col * vertices];
+        for (int v = 0; v < vertices; v++)
+        {
+            int p = parent[v];
+            if (p == -1)
+                continue;
+            for (int a = arcOffsets[v]; a < arcOffsets[v + 1]; a++)
+            {
+                if (arcs[a].dest == p && dist[p] + arcs[a].weight == dist[v])
+                {
+                    if (a - arcOffsets[v] < NO_HOP)
+                        hops[v] = a - arcOffsets[v];
+                    break;
+                }
+            }
+        }
+    }
+
+    void compact()
+    {
+        uint32_t largest = 0;
+        for (uint32_t d : dist32)
+        {
+            if (d != (uint32_t)INF)
+                largest = max(largest, d);
+        }
+        if (largest < 0xFFFF)
+        {
+            dist16.resize(dist32.size());
+            for (size_t i = 0; i < dist32.size(); i++)
+            {
+                dist16[i] = dist32[i] == (uint32_t)INF ? 0xFFFF : dist32[i];
+            }
+            dist32.clear();
+            dist32.shrink_to_fit();
+            wide = false;
+        }
+    }
+
+    bool covers(int source, int destination)
+    {
+        return rowOf[source] != -1 && colOf[destination] != -1;
+    }
+
+    int distance(int source, int destination)
+    {
+        size_t i = (size_t)colOf[destination] * rows + rowOf[source];
+        if (wide)
+        {
+            return dist32[i];
+        }
+        return dist16[i] == 0xFFFF ? INF : dist16[i];
+    }
+
+    bool hasNextHops() { return !hopArc.empty(); }
+
+    int nextHop(int node, int destination, const FlatArray<int> &arcOffsets, const FlatArray<Arc> &arcs)
+    {
+        uint16_t hop = hopArc[(size_t)colOf[destination] * vertices + node];
+        if (hop == NO_HOP)
+            return -1;
+        return arcs[arcOffsets[node] + hop].dest;
+    }
+
+    size_t memoryBytes()
+    {
+        return dist32.size() * sizeof(uint32_t) + dist16.size() * sizeof(uint16_t) + hopArc.size() * sizeof(uint16_t);
+    }
+};
+
+struct ShortestPathTree
+{
+    int source;
+    vector<int> dist;
+    vector<int> parent;
+
+    size_t memoryBytes() const
+    {
+        return sizeof(ShortestPathTree) + (dist.capacity() + parent.capacity()) * sizeof(int);
+    }
+};
+
+class TreeCache
+{
+private:
+    typedef shared_ptr<const ShortestPathTree> TreePtr;
+
+    size_t budgetBytes;
+    size_t usedBytes;
+    list<int> recent;
+    unordered_map<int, pair<TreePtr, list<int>::iterator>> entries;
+    long long hits;
+    long long misses;
+    mutex lock;
+
+    void evictUntilFits(size_t incoming)
+    {
+        while (!recent.empty() && usedBytes + incoming > budgetBytes)
+        {
+            auto it = entries.find(recent.back());
+            usedBytes -= it->second.first->memoryBytes();
+            entries.erase(it);
+            recent.pop_back();
+        }
+    }
+
+public:
+    TreeCache(size_t budget) : budgetBytes(budget), usedBytes(0), hits(0), misses(0) {}
+
+    TreePtr get(int source)
+    {
+        lock_guard<mutex> guard(lock);
+        auto it = entries.find(source);
+        if (it == entries.end())
+        {
+            misses++;
+            return TreePtr();
+        }
+        hits++;
+        recent.splice(recent.begin(), recent, it->second.second);
+        return it->second.first;
+    }
+
+    void put(TreePtr tree)
+    {
+        lock_guard<mutex> guard(lock);
+        size_t bytes = tree->memoryBytes();
+        if (bytes > budgetBytes || entries.count(tree->source))
+            return;
+
+        evictUntilFits(bytes);
+        recent.push_front(tree->source);
+        entries[tree->source] = make_pair(tree, recent.begin());
+        usedBytes += bytes;
+    }
+
+    void clear()
+    {
+        lock_guard<mutex> guard(lock);
+        entries.clear();
+        recent.clear();
+        usedBytes = 0;
+    }
+
+    void setBudget(size_t budget)
+    {
+        lock_guard<mutex> guard(lock);
+        budgetBytes = budget;
+        evictUntilFits(0);
+    }
+
+    long long getHits()
+    {
+        lock_guard<mutex> guard(lock);
+        return hits;
+    }
+
+    long long getMisses()
+    {
+        lock_guard<mutex> guard(lock);
+        return misses;
+    }
+
+    size_t getUsedBytes()
+    {
+        lock_guard<mutex> guard(lock);
+        return usedBytes;
+    }
+
+    int getSize()
+    {
+        lock_guard<mutex> guard(lock);
+        return entries.size();
+    }
+};
+
+class Graph
+{
+private:
+    int vertices;
+    FlatArray<NodeInfo> nodeInfo;
+    StringTable strings;
+
+    FlatArray<Edge> edges;
+    FlatArray<uint32_t> edgeStreets;
+
+    bool frozen;
+    FlatArray<int> arcOffsets;
+    FlatArray<Arc> arcs;
+    FlatArray<int> arcEdge;
+
+    MappedFile image;
+
+    ContractionHierarchy *hierarchy;
+    DistanceTable *distanceTable;
+    bool wantDistanceTable;
+
+    TreeCache treeCache;
+
+    RouteMode routeMode;
+    int landmarkCount;
+    vector<int> landmarkDist;
+
+    struct PointToPointState
+    {
+        vector<int> dist[2];
+        vector<int> parent[2];
+        vector<bool> settled[2];
+        vector<int> touched;
+        IndexedMinHeap heap[2] = {IndexedMinHeap(0), IndexedMinHeap(0)};
+
+        void reset(int vertices)
+        {
+            for (int side = 0; side < 2; side++)
+            {
+                if ((int)dist[side].size() < vertices)
+                {
+                    dist[side].assign(vertices, INF);
+                    parent[side].assign(vertices, -1);
+                    settled[side].assign(vertices, false);
+                }
+                heap[side].clear(vertices);
+            }
+            for (int v : touched)
+            {
+                for (int side = 0; side < 2; side++)
+                {
+                    dist[side][v] = INF;
+                    parent[side][v] = -1;
+                    settled[side][v] = false;
+                }
+            }
+            touched.clear();
+        }
+
+        void reach(int side, int v, int d, int from)
+        {
+            if (dist[0][v] == INF && dist[1][v] == INF)
+            {
+                touched.push_back(v);
+            }
+            dist[side][v] = d;
+            parent[side][v] = from;
+        }
+    };
+
+    int landmarkBound(int v, int target)
+    {
+        int bound = 0;
+        for (int k = 0; k < landmarkCount; k++)
+        {
+            int dv = landmarkDist[(size_t)k * vertices + v];
+            int dt = landmarkDist[(size_t)k * vertices + target];
+            if (dv != INF && dt != INF)
+            {
+                bound = max(bound, abs(dt - dv));
+            }
+        }
+        return bound;
+    }
+
+    int bidirectionalRoute(int source, int destination, vector<int> &path)
+    {
+        static thread_local PointToPointState state;
+        state.reset(vertices);
+
+        int start[2] = {source, destination};
+        for (int side = 0; side < 2; side++)
+        {
+            state.reach(side, start[side], 0, -1);
+            state.heap[side].push(start[side], 0);
+        }
+
+        int best = source == destination ? 0 : INF;
+        int meet = source == destination ? source : -1;
+
+        while (!state.heap[0].isEmpty() && !state.heap[1].isEmpty())
+        {
+            if (state.heap[0].minKey() + state.heap[1].minKey() >= best)
+                break;
+
+            int side = state.heap[0].minKey() <= state.heap[1].minKey() ? 0 : 1;
+            int u = state.heap[side].pop();
+            state.settled[side][u] = true;
+
+            for (int a = arcOffsets[u]; a < arcOffsets[u + 1]; a++)
+            {
+                int v = arcs[a].dest;
+                int nd = state.dist[side][u] + arcs[a].weight;
+                if (!state.settled[side][v] && nd < state.dist[side][v])
+                {
+                    state.reach(side, v, nd, u);
+                    state.heap[side].push(v, nd);
+                }
+                if (state.dist[1 - side][v] != INF && nd + state.dist[1 - side][v] < best)
+                {
+                    best = nd + state.dist[1 - side][v];
+                    meet = v;
+                }
+            }
+        }
+
+        path.clear();
+        if (meet == -1)
+        {
+            path.push_back(destination);
+            return INF;
+        }
+        for (int v = meet; v != -1; v = state.parent[0][v])
+        {
+            path.push_back(v);
+        }
+        reverse(path.begin(), path.end());
+        for (int v = state.parent[1][meet]; v != -1; v = state.parent[1][v])
+        {
+            path.push_back(v);
+        }
+        return best;
+    }
+
+    int landmarkRoute(int source, int destination, vector<int> &path)
+    {
+        static thread_local PointToPointState state;
+        state.reset(vertices);
+
+        state.reach(0, source, 0, -1);
+        state.heap[0].push(source, landmarkBound(source, destination));
+
+        while (!state.heap[0].isEmpty())
+        {
+            int u = state.heap[0].pop();
+            state.settled[0][u] = true;
+            if (u == destination)
+                break;
+
+            for (int a = arcOffsets[u]; a < arcOffsets[u + 1]; a++)
+            {
+                int v = arcs[a].dest;
+                int nd = state.dist[0][u] + arcs[a].weight;
+                if (!state.settled[0][v] && nd < state.dist[0][v])
+                {
+                    state.reach(0, v, nd, u);
+                    state.heap[0].push(v, nd + landmarkBound(v, destination));
+                }
+            }
+        }
+
+        path.clear();
+        if (!state.settled[0][destination])
+        {
+            path.push_back(destination);
+            return INF;
+        }
+        for (int v = destination; v != -1; v = state.parent[0][v])
+        {
+            path.push_back(v);
+        }
+        reverse(path.begin(), path.end());
+        return state.dist[0][destination];
+    }
+
+
+public:
+    struct SearchWorkspace
+    {
+        vector<int> dist;
+        vector<int> parent;
+        vector<int> found;
+        vector<bool> visited;
+        vector<int> touched;
+        IndexedMinHeap heap;
+
+        SearchWorkspace() : heap(0) {}
+
+        void reset(int vertices, bool trackParent)
+        {
+            if ((int)dist.size() != vertices)
+            {
+                dist.assign(vertices, INF);
+                visited.assign(vertices, false);
+                touched.clear();
+            }
+            if (trackParent && (int)parent.size() != vertices)
+            {
+                parent.assign(vertices, -1);
+            }
+            for (int v : touched)
+            {
+                dist[v] = INF;
+                visited[v] = false;
+                if ((int)parent.size() == vertices)
+                {
+                    parent[v] = -1;
+                }
+            }
+            touched.clear();
+            heap.clear(vertices);
+        }
+    };
+
+private:
+    template <typename Visitor>
+    void runDijkstra(int source, vector<int> &dist, vector<int> *parent, Visitor onSettle)
+    {
+        SearchWorkspace scratch;
+        runDijkstra(&source, 1, dist, parent, scratch, onSettle);
+    }
+
+    template <typename Visitor>
+    void runDijkstra(const vector<int> &sources, vector<int> &dist, vector<int> *parent, Visitor onSettle)
+    {
+        SearchWorkspace scratch;
+        runDijkstra(sources.data(), sources.size(), dist, parent, scratch, onSettle);
+    }
+
+    template <typename Visitor>
+    void runDijkstra(int source, SearchWorkspace &workspace, bool trackParent, Visitor onSettle)
+    {
+        runDijkstra(&source, 1, workspace.dist, trackParent ? &workspace.parent : nullptr, workspace, onSettle);
+    }
+
+    template <typename Visitor>
+    void runDijkstra(const int *sources, int count, vector<int> &dist, vector<int> *parent,
+                     SearchWorkspace &scratch, Visitor onSettle)
+    {
+        ensureFrozen();
+        bool sparse = &dist == &scratch.dist && (!parent || parent == &scratch.parent);
+        if (sparse)
+        {
+            scratch.reset(vertices, parent != nullptr);
+        }
+        else
+        {
+            dist.assign(vertices, INF);
+            if (parent)
+            {
+                parent->assign(vertices, -1);
+            }
+            if ((int)scratch.dist.size() == vertices)
+            {
+                scratch.reset(vertices, false);
+            }
+            else
+            {
+                scratch.visited.assign(vertices, false);
+                scratch.touched.clear();
+                scratch.heap.clear(vertices);
+            }
+        }
+        vector<bool> &visited = scratch.visited;
+        vector<int> &touched = scratch.touched;
+        IndexedMinHeap &heap = scratch.heap;
+
+        for (int i = 0; i < count; i++)
+        {
+            dist[sources[i]] = 0;
+            touched.push_back(sources[i]);
+            heap.push(sources[i], 0);
+        }
+
+        while (!heap.isEmpty())
+        {
+            int u = heap.pop();
+            visited[u] = true;
+
+            if (!onSettle(u))
+            {
+                break;
+            }
+
+            for (int a = arcOffsets[u]; a < arcOffsets[u + 1]; a++)
+            {
+                int v = arcs[a].dest;
+                int weight = arcs[a].weight;
+
+                if (!visited[v] && dist[u] + weight < dist[v])
+                {
+                    if (dist[v] == INF)
+                    {
+                        touched.push_back(v);
+                    }
+                    dist[v] = dist[u] + weight;
+                    if (parent)
+                    {
+                        (*parent)[v] = u;
+                    }
+                    heap.push(v, dist[v]);
+                }
+            }
+        }
+    }
+
+public:
+    static const size_t DEFAULT_TREE_CACHE_BYTES = 64 * 1024 * 1024;
+
+    Graph(int v)
+        : vertices(v), frozen(false), hierarchy(nullptr), distanceTable(nullptr), wantDistanceTable(false),
+          treeCache(DEFAULT_TREE_CACHE_BYTES), routeMode(ROUTE_TREE), landmarkCount(0)
+    {
+        nodeInfo.assign(vector<NodeInfo>(v));
+    }
+
+    ~Graph()
+    {
+        delete hierarchy;
+        delete distanceTable;
+    }
+
+    friend class FoodDeliverySimulator;
+
+    void setNodeInfo(int id, string_view name, string_view type)
+    {
+        if (id >= 0 && id < vertices)
+        {
+            nodeInfo.at(id) = NodeInfo(id, strings.intern(name), strings.intern(type));
+        }
+    }
+
+    string_view getNodeName(int id)
+    {
+        if (id >= 0 && id < vertices)
+        {
+            return strings.view(nodeInfo[id].name);
+        }
+        return "Unknown";
+    }
+
+    void addEdge(int src, int dest, int weight, string_view streetName = "")
+    {
+        edges.push_back(Edge(src, dest, weight));
+        edgeStreets.push_back(strings.intern(streetName));
+        frozen = false;
+        if (hierarchy)
+        {
+            delete hierarchy;
+            hierarchy = nullptr;
+        }
+        if (distanceTable)
+        {
+            delete distanceTable;
+            distanceTable = nullptr;
+        }
+        treeCache.clear();
+        landmarkCount = 0;
+    }
+
+    void freeze()
+    {
+        vector<int> offsets(vertices + 1, 0);
+        for (int e = 0; e < (int)edges.size(); e++)
+        {
+            offsets[edges[e].src + 1]++;
+            offsets[edges[e].dest + 1]++;
+        }
+        for (int i = 0; i < vertices; i++)
+        {
+            offsets[i + 1] += offsets[i];
+        }
+
+        vector<Arc> built(2 * edges.size());
+        vector<int> builtEdge(2 * edges.size());
+        vector<int> fill(offsets.begin(), offsets.end() - 1);
+        for (int e = 0; e < (int)edges.size(); e++)
+        {
+            int a = fill[edges[e].src]++;
+            built[a] = Arc{edges[e].dest, edges[e].weight};
+            builtEdge[a] = e;
+
+            a = fill[edges[e].dest]++;
+            built[a] = Arc{edges[e].src, edges[e].weight};
+            builtEdge[a] = e;
+        }
+        arcOffsets.assign(move(offsets));
+        arcs.assign(move(built));
+        arcEdge.assign(move(builtEdge));
+        frozen = true;
+    }
+
+    void ensureFrozen()
+    {
+        if (!frozen)
+        {
+            freeze();
+        }
+    }
+
+    bool saveSnapshot(const string &path)
+    {
+        ensureFrozen();
+
+        const char *section[SNAPSHOT_SECTION_COUNT] = {
+            (const char *)nodeInfo.data(), (const char *)edges.data(), (const char *)edgeStreets.data(),
+            (const char *)arcOffsets.data(), (const char *)arcs.data(), (const char *)arcEdge.data(),
+            (const char *)strings.getOffsets().data(), strings.getBytes().data()};
+
+        GraphSnapshotHeader header = {};
+        memcpy(header.magic, GRAPH_SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = GRAPH_SNAPSHOT_VERSION;
+        header.byteOrder = GRAPH_SNAPSHOT_BYTE_ORDER;
+        header.vertices = vertices;
+        header.edgeCount = edges.size();
+        header.stringCount = strings.getCount();
+        header.length[SNAPSHOT_NODES] = nodeInfo.size() * sizeof(NodeInfo);
+        header.length[SNAPSHOT_EDGES] = edges.size() * sizeof(Edge);
+        header.length[SNAPSHOT_EDGE_STREETS] = edgeStreets.size() * sizeof(uint32_t);
+        header.length[SNAPSHOT_ARC_OFFSETS] = arcOffsets.size() * sizeof(int);
+        header.length[SNAPSHOT_ARCS] = arcs.size() * sizeof(Arc);
+        header.length[SNAPSHOT_ARC_EDGES] = arcEdge.size() * sizeof(int);
+        header.length[SNAPSHOT_STRING_OFFSETS] = strings.getOffsets().size() * sizeof(uint32_t);
+        header.length[SNAPSHOT_STRING_BYTES] = strings.getBytes().size();
+
+        uint64_t end = sizeof(GraphSnapshotHeader);
+        header.checksum = 14695981039346656037ULL;
+        for (int s = 0; s < SNAPSHOT_SECTION_COUNT; s++)
+        {
+            header.offset[s] = (end + GRAPH_SNAPSHOT_ALIGN - 1) / GRAPH_SNAPSHOT_ALIGN * GRAPH_SNAPSHOT_ALIGN;
+            end = header.offset[s] + header.length[s];
+            header.checksum = snapshotChecksum(section[s], header.length[s], header.checksum);
+        }
+
+        string temp = path + ".tmp";
+        DurableFile file;
+        if (!file.open(temp, true))
+        {
+            return false;
+        }
+
+        static const char padding[GRAPH_SNAPSHOT_ALIGN] = {};
+        bool written = file.write((const char *)&header, sizeof(header));
+        uint64_t position = sizeof(header);
+        for (int s = 0; s < SNAPSHOT_SECTION_COUNT && written; s++)
+        {
+            written = file.write(padding, header.offset[s] - position) && file.write(section[s], header.length[s]);
+            position = header.offset[s] + header.length[s];
+        }
+        written = written && file.sync();
+        file.close();
+
+        if (!written || !DurableFile::replace(temp, path))
+        {
+            remove(temp.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    static Graph *openSnapshot(const string &path)
+    {
+        Graph *graph = new Graph(0);
+        if (!graph->attachSnapshot(path))
+        {
+            delete graph;
+            return nullptr;
+        }
+        return graph;
+    }
+
+    bool attachSnapshot(const string &path)
+    {
+        if (!image.open(path, false))
+        {
+            return false;
+        }
+
+        string_view file = image.view();
+        GraphSnapshotHeader header;
+        if (file.size() < sizeof(header))
+        {
+            return false;
+        }
+        memcpy(&header, file.data(), sizeof(header));
+        if (memcmp(header.magic, GRAPH_SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != GRAPH_SNAPSHOT_VERSION || header.byteOrder != GRAPH_SNAPSHOT_BYTE_ORDER ||
+            header.vertices > (uint64_t)INT32_MAX || header.edgeCount > (uint64_t)INT32_MAX / 2)
+        {
+            return false;
+        }
+
+        uint64_t expected[SNAPSHOT_SECTION_COUNT] = {
+            header.vertices * sizeof(NodeInfo), header.edgeCount * sizeof(Edge), header.edgeCount * sizeof(uint32_t),
+            (header.vertices + 1) * sizeof(int), 2 * header.edgeCount * sizeof(Arc), 2 * header.edgeCount * sizeof(int),
+            (header.stringCount + 1) * sizeof(uint32_t), header.length[SNAPSHOT_STRING_BYTES]};
+
+        uint64_t checksum = 14695981039346656037ULL;
+        for (int s = 0; s < SNAPSHOT_SECTION_COUNT; s++)
+        {
+            if (header.length[s] != expected[s] || header.offset[s] % GRAPH_SNAPSHOT_ALIGN != 0 ||
+                header.offset[s] > file.size() || header.length[s] > file.size() - header.offset[s])
+            {
+                return false;
+            }
+            checksum = snapshotChecksum(file.data() + header.offset[s], header.length[s], checksum);
+        }
+        if (checksum != header.checksum)
+        {
+            return false;
+        }
+
+        const char *base = file.data();
+        int lastOffset;
+        uint32_t lastString;
+        memcpy(&lastOffset, base + header.offset[SNAPSHOT_ARC_OFFSETS] + header.vertices * sizeof(int), sizeof(int));
+        memcpy(&lastString, base + header.offset[SNAPSHOT_STRING_OFFSETS] + header.stringCount * sizeof(uint32_t),
+               sizeof(uint32_t));
+        if ((uint64_t)lastOffset != 2 * header.edgeCount || lastString != header.length[SNAPSHOT_STRING_BYTES])
+        {
+            return false;
+        }
+
+        vertices = header.vertices;
+        nodeInfo.borrow((const NodeInfo *)(base + header.offset[SNAPSHOT_NODES]), header.vertices);
+        edges.borrow((const Edge *)(base + header.offset[SNAPSHOT_EDGES]), header.edgeCount);
+        edgeStreets.borrow((const uint32_t *)(base + header.offset[SNAPSHOT_EDGE_STREETS]), header.edgeCount);
+        arcOffsets.borrow((const int *)(base + header.offset[SNAPSHOT_ARC_OFFSETS]), header.vertices + 1);
+        arcs.borrow((const Arc *)(base + header.offset[SNAPSHOT_ARCS]), 2 * header.edgeCount);
+        arcEdge.borrow((const int *)(base + header.offset[SNAPSHOT_ARC_EDGES]), 2 * header.edgeCount);
+        strings.borrow((const uint32_t *)(base + header.offset[SNAPSHOT_STRING_OFFSETS]), header.stringCount,
+                       base + header.offset[SNAPSHOT_STRING_BYTES], header.length[SNAPSHOT_STRING_BYTES]);
+        frozen = true;
+        return true;
+    }
+
+    int findArc(int from, int to)
+    {
+        ensureFrozen();
+        for (int a = arcOffsets[from]; a < arcOffsets[from + 1]; a++)
+        {
+            if (arcs[a].dest == to)
+            {
+                return a;
+            }
+        }
+        return -1;
+    }
+
+    void buildContractionHierarchy()
+    {
+        ensureFrozen();
+        delete hierarchy;
+        hierarchy = new ContractionHierarchy(vertices, arcOffsets, arcs);
+    }
+
+    bool hasContractionHierarchy() { return hierarchy != nullptr; }
+
+    bool buildDistanceTable()
+    {
+        ensureFrozen();
+        wantDistanceTable = true;
+
+        vector<int> sources;
+        vector<int> targets;
+        for (int i = 0; i < vertices; i++)
+        {
+            if (strings.view(nodeInfo[i].type) == "restaurant")
+                sources.push_back(i);
+            else if (strings.view(nodeInfo[i].type) == "delivery")
+                targets.push_back(i);
+        }
+        if (!DistanceTable::fits(vertices, sources.size(), targets.size()))
+        {
+            wantDistanceTable = false;
+            return false;
+        }
+
+        DistanceTable *table = new DistanceTable(vertices, sources, targets);
+        atomic<int> nextTarget(0);
+
+        auto worker = [&]()
+        {
+            SearchWorkspace workspace;
+            for (int t = nextTarget++; t < (int)targets.size(); t = nextTarget++)
+            {
+                runDijkstra(targets[t], workspace, true, [](int) { return true; });
+                table->fillColumn(t, sources, workspace.dist, workspace.parent, arcOffsets, arcs);
+            }
+        };
+
+        int workers = max(1, min((int)thread::hardware_concurrency(), (int)targets.size()));
+        vector<thread> threads;
+        for (int i = 1; i < workers; i++)
+        {
+            threads.push_back(thread(worker));
+        }
+        worker();
+        for (thread &t : threads)
+        {
+            t.join();
+        }
+
+        table->compact();
+        delete distanceTable;
+        distanceTable = table;
+        return true;
+    }
+
+    bool hasDistanceTable() { return distanceTable != nullptr; }
+
+    void prepareForQueries()
+    {
+        ensureFrozen();
+        if (wantDistanceTable && !distanceTable)
+        {
+            buildDistanceTable();
+        }
+    }
+
+    bool lookupDistance(int source, int destination, int &distance)
+    {
+        if (wantDistanceTable && !distanceTable)
+        {
+            buildDistanceTable();
+        }
+        if (!distanceTable || !distanceTable->covers(source, destination))
+        {
+            return false;
+        }
+        distance = distanceTable->distance(source, destination);
+        return true;
+    }
+
+    int shortestRoute(int source, int destination, vector<int> &path)
+    {
+        int distance;
+        if (lookupDistance(source, destination, distance) && distanceTable->hasNextHops())
+        {
+            path.clear();
+            path.push_back(source);
+            if (distance == INF)
+            {
+                path[0] = destination;
+                return INF;
+            }
+            int v = source;
+            while (v != -1 && v != destination)
+            {
+                v = distanceTable->nextHop(v, destination, arcOffsets, arcs);
+                path.push_back(v);
+            }
+            if (v == destination)
+            {
+                return distance;
+            }
+        }
+
+        if (hierarchy)
+        {
+            return hierarchy->query(source, destination, path);
+        }
+
+        return pointToPoint(source, destination, path, routeMode);
+    }
+
+    int pointToPoint(int source, int destination, vector<int> &path, RouteMode mode)
+    {
+        ensureFrozen();
+        if (mode == ROUTE_BIDIRECTIONAL)
+        {
+            return bidirectionalRoute(source, destination, path);
+        }
+        if (mode == ROUTE_ALT && landmarkCount > 0)
+        {
+            return landmarkRoute(source, destination, path);
+        }
+
+        shared_ptr<const ShortestPathTree> tree = shortestPathTree(source);
+        path.clear();
+        for (int current = destination; current != -1; current = tree->parent[current])
+        {
+            path.push_back(current);
+        }
+        reverse(path.begin(), path.end());
+        return tree->dist[destination];
+    }
+
+    shared_ptr<const ShortestPathTree> shortestPathTree(int source)
+    {
+        shared_ptr<const ShortestPathTree> cached = treeCache.get(source);
+        if (cached)
+        {
+            return cached;
+        }
+
+        shared_ptr<ShortestPathTree> tree = make_shared<ShortestPathTree>();
+        tree->source = source;
+        runDijkstra(source, tree->dist, &tree->parent, [](int) { return true; });
+        treeCache.put(tree);
+        return tree;
+    }
+
+    void buildLandmarks(int count)
+    {
+        ensureFrozen();
+        count = min(count, vertices);
+        landmarkDist.assign((size_t)count * vertices, INF);
+        landmarkCount = 0;
+
+        vector<int> closest(vertices, INF);
+        int next = 0;
+        SearchWorkspace workspace;
+        vector<int> &dist = workspace.dist;
+        for (int k = 0; k < count; k++)
+        {
+            runDijkstra(next, workspace, false, [](int) { return true; });
+            copy(dist.begin(), dist.end(), landmarkDist.begin() + (size_t)k * vertices);
+            landmarkCount++;
+
+            for (int v = 0; v < vertices; v++)
+            {
+                closest[v] = min(closest[v], dist[v]);
+            }
+
+            next = -1;
+            for (int v = 0; v < vertices; v++)
+            {
+                if (closest[v] > 0 && (next == -1 || closest[v] > closest[next]))
+                {
+                    next = v;
+                }
+            }
+            if (next == -1)
+                break;
+        }
+        routeMode = ROUTE_ALT;
+    }
+
+    void setRouteMode(RouteMode mode) { routeMode = mode; }
+
+    void setTreeCacheBudget(size_t bytes) { treeCache.setBudget(bytes); }
+    long long getTreeCacheHits() { return treeCache.getHits(); }
+    long long getTreeCacheMisses() { return treeCache.getMisses(); }
+
+    string_view getStreetName(int from, int to)
+    {
+        int a = findArc(from, to);
+        if (a != -1)
+        {
+            return strings.view(edgeStreets[arcEdge[a]]);
+        }
+        return "Unknown Street";
+    }
+
+    void displayPath(int source, int destination, vector<int> &parent, int totalDistance)
+    {
+        vector<int> path;
+        int current = destination;
+
+        while (current != -1)
+        {
+            path.push_back(current);
+            current = parent[current];
+        }
+
+        reverse(path.begin(), path.end());
+
+        displayRoute(source, destination, path, totalDistance);
+    }
+
+    void displayRoute(int source, int destination, const vector<int> &path, int totalDistance)
+    {
+        int eta = (totalDistance * 60) / 30;
+
+        cout << "\n========== Route Details ==========" << endl;
+        cout << "From: " << getNodeName(source) << " (Restaurant)" << endl;
+        cout << "To: " << getNodeName(destination) << " (Delivery Point)" << endl;
+        cout << "Total Distance: " << totalDistance << " km" << endl;
+        cout << "Estimated Time (ETA): " << eta << " minutes" << endl;
+        cout << "\nPath:" << endl;
+
+        for (int i = 0; i < (int)path.size(); i++)
+        {
+            cout << "  " << (i + 1) << ". " << getNodeName(path[i]);
+            if (i < (int)path.size() - 1)
+            {
+                string_view street = getStreetName(path[i], path[i + 1]);
+                int segmentDist = 0;
+
+                int a = findArc(path[i], path[i + 1]);
+                if (a != -1)
+                {
+                    segmentDist = arcs[a].weight;
+                }
+
+                cout << " --> [" << street << ", " << segmentDist << " km] -->";
+            }
+            cout << endl;
+        }
+        cout << "===================================" << endl;
+    }
+
+    vector<int> dijkstra(int source)
+    {
+        SearchWorkspace workspace;
+        dijkstra(source, workspace);
+        return move(workspace.dist);
+    }
+
+    const vector<int> &dijkstra(int source, SearchWorkspace &workspace)
+    {
+        runDijkstra(source, workspace, false, [](int) { return true; });
+        return workspace.dist;
+    }
+
+    void dijkstraWithPath(int source, SearchWorkspace &workspace)
+    {
+        runDijkstra(source, workspace, true, [](int) { return true; });
+    }
+
+    template <typename Predicate>
+    vector<int> nearestMatching(int source, Predicate isTarget, int &foundDist)
+    {
+        SearchWorkspace workspace;
+        nearestMatching(source, isTarget, foundDist, workspace);
+        return move(workspace.found);
+    }
+
+    template <typename Predicate>
+    const vector<int> &nearestMatching(int source, Predicate isTarget, int &foundDist, SearchWorkspace &workspace)
+    {
+        vector<int> &dist = workspace.dist;
+        vector<int> &found = workspace.found;
+        found.clear();
+        foundDist = INF;
+
+        runDijkstra(source, workspace, false, [&](int u)
+        {
+            if (dist[u] > foundDist)
+                return false;
+            if (isTarget(u))
+            {
+                foundDist = dist[u];
+                found.push_back(u);
+            }
+            return true;
+        });
+        return found;
+    }
+
+    vector<int> partitionByNearest(const vector<int> &sources)
+    {
+        vector<int> label(vertices, -1);
+        vector<int> valid;
+        for (int i = 0; i < (int)sources.size(); i++)
+        {
+            int source = sources[i];
+            if (source >= 0 && source < vertices && label[source] == -1)
+            {
+                label[source] = i;
+                valid.push_back(source);
+            }
+        }
+        if (valid.empty())
+        {
+            return label;
+        }
+
+        vector<int> dist;
+        vector<int> parent;
+        runDijkstra(valid, dist, &parent, [&](int u)
+        {
+            if (parent[u] != -1)
+                label[u] = label[parent[u]];
+            return true;
+        });
+        return label;
+    }
+
+    int getVertices() { return vertices; }
+};
+
+struct User
+{
+    int id;
+    StringId name;
+    int nodeId;
+
+    User() : id(0), name(0), nodeId(0) {}
+    User(int i, string_view n, int nid) : id(i), name(StringPool::intern(n)), nodeId(nid) {}
+
+    void appendCsv(string &out) const
+    {
+        out += to_string(id);
+        out += ',';
+        out += StringPool::view(name);
+        out += ',';
+        out += to_string(nodeId);
+        out += '\n';
+    }
+
+    friend ostream &operator<<(ostream &os, const User &u)
+    {
+        os << "User ID: " << u.id << ", Name: " << StringPool::view(u.name) << ", Node: " << u.nodeId;
+        return os;
+    }
+};
+
+struct Agent
+{
+    int id;
+    StringId name;
+    int nodeId;
+    bool available;
+    int rank;
+    Agent *prevFree;
+    Agent *nextFree;
+
+    Agent() : id(0), name(0), nodeId(0), available(true), rank(-1), prevFree(nullptr), nextFree(nullptr) {}
+    Agent(int i, string_view n, int nid)
+        : id(i), name(StringPool::intern(n)), nodeId(nid), available(true), rank(-1), prevFree(nullptr), nextFree(nullptr) {}
+
+    friend ostream &operator<<(ostream &os, const Agent &a)
+    {
+        os << "Agent ID: " << a.id << ", Name: " << StringPool::view(a.name)
+           << ", Node: " << a.nodeId << ", Status: " << (a.available ? "Available" : "Busy");
+        return os;
+    }
+};
+
+class AgentLocator
+{
+private:
+    vector<Agent *> freeAt;
+    vector<int> zoneOfNode;
+    vector<int> freeInZone;
+    int freeTotal;
+
+    bool onGraph(Agent *agent)
+    {
+        return agent->nodeId >= 0 && agent->nodeId < (int)freeAt.size();
+    }
+
+    void link(Agent *agent)
+    {
+        Agent *&head = freeAt[agent->nodeId];
+        agent->prevFree = nullptr;
+        agent->nextFree = head;
+        if (head)
+        {
+            head->prevFree = agent;
+        }
+        head = agent;
+        adjust(agent->nodeId, 1);
+    }
+
+    void unlink(Agent *agent)
+    {
+        if (agent->prevFree)
+        {
+            agent->prevFree->nextFree = agent->nextFree;
+        }
+        else
+        {
+            freeAt[agent->nodeId] = agent->nextFree;
+        }
+        if (agent->nextFree)
+        {
+            agent->nextFree->prevFree = agent->prevFree;
+        }
+        agent->prevFree = agent->nextFree = nullptr;
+        adjust(agent->nodeId, -1);
+    }
+
+    void adjust(int node, int delta)
+    {
+        freeTotal += delta;
+        if (zoneOfNode[node] != -1)
+        {
+            freeInZone[zoneOfNode[node]] += delta;
+        }
+    }
+
+public:
+    AgentLocator() : freeTotal(0) {}
+
+    void build(const vector<Agent *> &agents, const vector<int> &zones, int zoneCount)
+    {
+        freeAt.assign(zones.size(), nullptr);
+        zoneOfNode = zones;
+        freeInZone.assign(zoneCount, 0);
+        freeTotal = 0;
+
+        for (int i = agents.size() - 1; i >= 0; i--)
+        {
+            if (agents[i]->available && onGraph(agents[i]))
+            {
+                link(agents[i]);
+            }
+        }
+    }
+
+    void setAvailable(Agent *agent, bool available)
+    {
+        if (agent->available == available)
+        {
+            return;
+        }
+        agent->available = available;
+        if (!onGraph(agent))
+        {
+            return;
+        }
+        if (available)
+            link(agent);
+        else
+            unlink(agent);
+    }
+
+    bool hasAvailableAt(int node) { return freeAt[node] != nullptr; }
+    Agent *availableAt(int node) { return freeAt[node]; }
+
+    Agent *lowestRankAt(int node)
+    {
+        Agent *best = nullptr;
+        for (Agent *agent = freeAt[node]; agent; agent = agent->nextFree)
+        {
+            if (!best || agent->rank < best->rank)
+            {
+                best = agent;
+            }
+        }
+        return best;
+    }
+
+    int zoneOf(int node) { return zoneOfNode[node]; }
+    int getZoneCount() { return freeInZone.size(); }
+    int freeInZoneCount(int zone) { return freeInZone[zone]; }
+    int freeCount() { return freeTotal; }
+};
+
+enum OrderStatus : uint8_t
+{
+    ORDER_PENDING,
+    ORDER_ASSIGNED,
+    ORDER_DELIVERED,
+    ORDER_CANCELLED
+};
+
+inline const char *statusName(OrderStatus status)
+{
+    switch (status)
+    {
+    case ORDER_ASSIGNED:
+        return "Assigned";
+    case ORDER_DELIVERED:
+        return "Delivered";
+    case ORDER_CANCELLED:
+        return "Cancelled";
+    default:
+        return "Pending";
+    }
+}
+
+inline OrderStatus parseStatus(string_view name)
+{
+    if (name == "Assigned")
+        return ORDER_ASSIGNED;
+    if (name == "Delivered")
+        return ORDER_DELIVERED;
+    if (name == "Cancelled")
+        return ORDER_CANCELLED;
+    return ORDER_PENDING;
+}
+
+struct Order
+{
+    int32_t orderId;
+    int32_t userId;
+    int32_t restaurantId;
+    int32_t agentId;
+    int16_t priority;
+    OrderStatus status;
+
+    static const int MIN_PRIORITY = 1;
+    static const int MAX_PRIORITY = 10;
+
+    Order() : orderId(0), userId(0), restaurantId(0), agentId(-1), priority(0), status(ORDER_PENDING) {}
+    Order(int oid, int uid, int rid, int p)
+        : orderId(oid), userId(uid), restaurantId(rid), agentId(-1),
+          priority(min(max(p, MIN_PRIORITY), MAX_PRIORITY)), status(ORDER_PENDING) {}
+
+    static bool validPriority(int p) { return p >= MIN_PRIORITY && p <= MAX_PRIORITY; }
+
+    void appendCsv(string &out) const
+    {
+        out += to_string(orderId);
+        out += ',';
+        out += to_string(userId);
+        out += ',';
+        out += to_string(restaurantId);
+        out += ',';
+        out += to_string(agentId);
+        out += ',';
+        out += to_string(priority);
+        out += ',';
+        out += statusName(status);
+        out += '\n';
+    }
+
+    friend ostream &operator<<(ostream &os, const Order &o)
+    {
+        os << "Order ID: " << o.orderId << ", User: " << o.userId
+           << ", Restaurant: " << o.restaurantId << ", Agent: " << o.agentId
+           << ", Priority: " << o.priority << ", Status: " << statusName(o.status);
+        return os;
+    }
+};
+
+class OrderStore
+{
+private:
+    vector<int32_t> orderIds;
+    vector<int32_t> userIds;
+    vector<int32_t> restaurantIds;
+    vector<int32_t> agentIds;
+    vector<int16_t> priorities;
+    vector<OrderStatus> statuses;
+
+    vector<int> rowById;
+    unordered_map<int, int> sparseRowById;
+
+    void indexRow(int orderId, int row)
+    {
+        if (orderId >= 0 && orderId < max((int)rowById.size(), 2 * (int)orderIds.size()) + 1024)
+        {
+            if (orderId >= (int)rowById.size())
+            {
+                rowById.resize(max(orderId + 1, 2 * (int)rowById.size()), -1);
+            }
+            rowById[orderId] = row;
+        }
+        else
+        {
+            sparseRowById[orderId] = row;
+        }
+    }
+
+public:
+    int put(const Order &order)
+    {
+        int row = findRow(order.orderId);
+        if (row == -1)
+        {
+            return append(order);
+        }
+        userIds[row] = order.userId;
+        restaurantIds[row] = order.restaurantId;
+        agentIds[row] = order.agentId;
+        priorities[row] = order.priority;
+        statuses[row] = order.status;
+        return row;
+    }
+
+    int append(const Order &order)
+    {
+        int row = orderIds.size();
+        orderIds.push_back(order.orderId);
+        userIds.push_back(order.userId);
+        restaurantIds.push_back(order.restaurantId);
+        agentIds.push_back(order.agentId);
+        priorities.push_back(order.priority);
+        statuses.push_back(order.status);
+        indexRow(order.orderId, row);
+        return row;
+    }
+
+    Order get(int row) const
+    {
+        Order order(orderIds[row], userIds[row], restaurantIds[row], priorities[row]);
+        order.agentId = agentIds[row];
+        order.status = statuses[row];
+        return order;
+    }
+
+    int findRow(int orderId) const
+    {
+        if (orderId >= 0 && orderId < (int)rowById.size() && rowById[orderId] != -1)
+        {
+            return rowById[orderId];
+        }
+        auto it = sparseRowById.find(orderId);
+        return it == sparseRowById.end() ? -1 : it->second;
+    }
+
+    void display() const
+    {
+        for (int row = 0; row < getSize(); row++)
+        {
+            cout << get(row) << endl;
+        }
+    }
+
+    template <typename Sink>
+    void save(Sink sink) const
+    {
+        string buffer;
+        for (int row = 0; row < getSize(); row++)
+        {
+            get(row).appendCsv(buffer);
+            if (buffer.size() >= (1 << 20))
+            {
+                sink(buffer);
+                buffer.clear();
+            }
+        }
+        sink(buffer);
+    }
+
+    int getSize() const { return orderIds.size(); }
+};
+
+class CsvReader
+{
+private:
+    string_view text;
+    size_t position;
+    int line;
+
+public:
+    CsvReader(string_view t, int firstLine = 1) : text(t), position(0), line(firstLine - 1) {}
+
+    bool nextRow(vector<string_view> &fields)
+    {
+        while (position < text.size())
+        {
+            size_t end = text.find('\n', position);
+            if (end == string_view::npos)
+            {
+                end = text.size();
+            }
+            string_view row = text.substr(position, end - position);
+            position = end + 1;
+            line++;
+
+            if (!row.empty() && row.back() == '\r')
+            {
+                row.remove_suffix(1);
+            }
+            if (row.empty())
+            {
+                continue;
+            }
+
+            fields.clear();
+            size_t start = 0;
+            while (true)
+            {
+                size_t comma = row.find(',', start);
+                if (comma == string_view::npos)
+                {
+                    fields.push_back(row.substr(start));
+                    break;
+                }
+                fields.push_back(row.substr(start, comma - start));
+                start = comma + 1;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void skipLine()
+    {
+        size_t end = text.find('\n', position);
+        position = end == string_view::npos ? text.size() : end + 1;
+        line++;
     }
 
-    ~BST()
+    int getLine() { return line; }
+    string_view rest() { return text.substr(min(position, text.size())); }
+
+    static bool parseInt(string_view field, int &value)
     {
-        destroyTree(root);
+        while (!field.empty() && field.front() == ' ')
+            field.remove_prefix(1);
+        while (!field.empty() && field.back() == ' ')
+            field.remove_suffix(1);
+
+        bool negative = !field.empty() && field.front() == '-';
+        if (negative)
+            field.remove_prefix(1);
+        if (field.empty() || field.size() > 10)
+            return false;
+
+        long long result = 0;
+        for (char c : field)
+        {
+            if (c < '0' || c > '9')
+                return false;
+            result = result * 10 + (c - '0');
+        }
+        result = negative ? -result : result;
+        if (result < INT32_MIN || result > INT32_MAX)
+            return false;
+        value = (int)result;
+        return true;
     }
-};
-
-struct Edge
-{
-    int dest;
-    int weight;
-    string streetName;
 
-    Edge(int d, int w, string name = "") : dest(d), weight(w), streetName(name) {}
+    static vector<string_view> splitAtLines(string_view text, int parts)
+    {
+        vector<string_view> chunks;
+        size_t begin = 0;
+        for (int k = 1; k <= parts && begin < text.size(); k++)
+        {
+            size_t end = k == parts ? text.size() : text.size() * k / parts;
+            if (end < begin)
+                end = begin;
+            size_t newline = text.find('\n', end);
+            end = (k == parts || newline == string_view::npos) ? text.size() : newline + 1;
+            if (end > begin)
+                chunks.push_back(text.substr(begin, end - begin));
+            begin = end;
+        }
+        return chunks;
+    }
 };
 
-struct NodeInfo
+bool findJsonField(string_view object, string_view key, string_view &value)
 {
-    int id;
-    string name;
-    string type;
+    size_t position = 0;
+    while ((position = object.find('"', position)) != string_view::npos)
+    {
+        size_t close = object.find('"', position + 1);
+        if (close == string_view::npos)
+            return false;
+        string_view name = object.substr(position + 1, close - position - 1);
+        size_t colon = object.find_first_not_of(" \t", close + 1);
+        if (colon == string_view::npos || object[colon] != ':')
+        {
+            position = close + 1;
+            continue;
+        }
 
-    NodeInfo() : id(0), name(""), type("") {}
-    NodeInfo(int i, string n, string t) : id(i), name(n), type(t) {}
-};
+        size_t start = object.find_first_not_of(" \t", colon + 1);
+        if (start == string_view::npos)
+            return false;
+        size_t end;
+        if (object[start] == '"')
+        {
+            end = object.find('"', start + 1);
+            if (end == string_view::npos)
+                return false;
+            if (name == key)
+            {
+                value = object.substr(start + 1, end - start - 1);
+                return true;
+            }
+            end++;
+        }
+        else
+        {
+            end = object.find_first_of(",}", start);
+            if (end == string_view::npos)
+                end = object.size();
+            if (name == key)
+            {
+                value = object.substr(start, end - start);
+                return true;
+            }
+        }
+        position = end;
+    }
+    return false;
+}
 
-class Graph
+class OrderJournal
 {
 private:
-    int vertices;
-    LinkedList<Edge> *adjList;
-    vector<NodeInfo> nodeInfo;
+    string path;
+    DurableFile file;
+    string buffer;
+    int staged;
+    int records;
 
 public:
-    Graph(int v) : vertices(v)
+    OrderJournal() : staged(0), records(0) {}
+
+    bool open(const string &journalPath, int existingRecords)
     {
-        adjList = new LinkedList<Edge>[v];
-        nodeInfo.resize(v);
+        path = journalPath;
+        records = existingRecords;
+        return file.open(path, false);
     }
 
-    friend class FoodDeliverySimulator;
+    void stage(const Order &order)
+    {
+        order.appendCsv(buffer);
+        staged++;
+    }
 
-    void setNodeInfo(int id, string name, string type)
+    bool commit()
     {
-        if (id >= 0 && id < vertices)
+        if (staged == 0)
         {
-            nodeInfo[id] = NodeInfo(id, name, type);
+            return true;
         }
+        bool ok = file.isOpen() && file.write(buffer) && file.sync();
+        buffer.clear();
+        records += staged;
+        staged = 0;
+        return ok;
     }
 
-    string getNodeName(int id)
+    bool rotate(const string &archive)
     {
-        if (id >= 0 && id < vertices)
+        commit();
+        file.close();
+        bool moved = DurableFile::replace(path, archive);
+        if (!DurableFile::exists(path))
         {
-            return nodeInfo[id].name;
+            records = 0;
         }
-        return "Unknown";
+        return file.open(path, false) && moved;
     }
 
-    void addEdge(int src, int dest, int weight, string streetName = "")
+    void close()
     {
-        adjList[src].insert(Edge(dest, weight, streetName));
-        adjList[dest].insert(Edge(src, weight, streetName));
+        commit();
+        file.close();
     }
 
-    pair<vector<int>, vector<int>> dijkstraWithPath(int source, int destination)
-    {
-        vector<int> dist(vertices, INF);
-        vector<int> parent(vertices, -1);
-        vector<bool> visited(vertices, false);
-
-        dist[source] = 0;
+    int getRecordCount() { return records; }
+};
 
-        for (int count = 0; count < vertices - 1; count++)
+class UserStore
+{
+private:
+    DurableFile file;
+    string buffer;
+    int staged;
+    bool stopping;
+    bool failed;
+    mutex lock;
+    condition_variable wake;
+    thread flusher;
+
+    bool writeLocked()
+    {
+        if (staged == 0)
         {
-            int u = -1;
-            int minDist = INF;
+            return true;
+        }
+        bool ok = file.isOpen() && file.write(buffer) && file.sync();
+        buffer.clear();
+        staged = 0;
+        return ok;
+    }
 
-            for (int i = 0; i < vertices; i++)
+    void run()
+    {
+        unique_lock<mutex> guard(lock);
+        while (!stopping)
+        {
+            wake.wait(guard, [this]() { return stopping || staged > 0; });
+            if (wake.wait_for(guard, FLUSH_INTERVAL, [this]() { return stopping || staged == 0; }))
+                continue;
+            // Reported by the next flush or close on the owning thread
+            if (!writeLocked())
             {
-                if (!visited[i] && dist[i] < minDist)
-                {
-                    minDist = dist[i];
-                    u = i;
-                }
+                failed = true;
             }
+        }
+    }
 
-            if (u == -1)
-                break;
-
-            visited[u] = true;
+public:
+    static const int BATCH_USERS = 256;
+    static constexpr chrono::milliseconds FLUSH_INTERVAL{1000};
 
-            Node<Edge> *temp = adjList[u].getHead();
-            while (temp)
-            {
-                int v = temp->data.dest;
-                int weight = temp->data.weight;
+    UserStore() : staged(0), stopping(false), failed(false) {}
+    ~UserStore() { close(); }
 
-                if (!visited[v] && dist[u] != INF && dist[u] + weight < dist[v])
-                {
-                    dist[v] = dist[u] + weight;
-                    parent[v] = u;
-                }
-                temp = temp->next;
-            }
+    bool open(const string &path)
+    {
+        bool fresh = DurableFile::sizeOf(path) <= 0;
+        if (!file.open(path, false) || (fresh && !file.write("id,name,nodeId\n")))
+        {
+            return false;
         }
-
-        return make_pair(dist, parent);
+        stopping = false;
+        flusher = thread(&UserStore::run, this);
+        return true;
     }
 
-    string getStreetName(int from, int to)
+    bool stage(const User &user)
     {
-        Node<Edge> *temp = adjList[from].getHead();
-        while (temp)
+        lock_guard<mutex> guard(lock);
+        if (!file.isOpen())
         {
-            if (temp->data.dest == to)
-            {
-                return temp->data.streetName;
-            }
-            temp = temp->next;
+            return false;
         }
-        return "Unknown Street";
+        user.appendCsv(buffer);
+        if (++staged >= BATCH_USERS)
+        {
+            return writeLocked();
+        }
+        if (staged == 1)
+        {
+            wake.notify_one();
+        }
+        return true;
     }
 
-    void displayPath(int source, int destination, vector<int> &parent, int totalDistance)
+    bool flush()
     {
-        vector<int> path;
-        int current = destination;
+        lock_guard<mutex> guard(lock);
+        bool ok = writeLocked() && !failed;
+        failed = false;
+        return ok;
+    }
 
-        while (current != -1)
+    bool close()
+    {
+        if (flusher.joinable())
         {
-            path.push_back(current);
-            current = parent[current];
+            {
+                lock_guard<mutex> guard(lock);
+                stopping = true;
+            }
+            wake.notify_one();
+            flusher.join();
         }
+        bool ok = flush();
+        file.close();
+        return ok;
+    }
+};
 
-        reverse(path.begin(), path.end());
-
-        int eta = (totalDistance * 60) / 30;
+struct Assignment
+{
+    int orderId;
+    int agentId;
 
-        cout << "\n========== Route Details ==========" << endl;
-        cout << "From: " << getNodeName(source) << " (Restaurant)" << endl;
-        cout << "To: " << getNodeName(destination) << " (Delivery Point)" << endl;
-        cout << "Total Distance: " << totalDistance << " km" << endl;
-        cout << "Estimated Time (ETA): " << eta << " minutes" << endl;
-        cout << "\nPath:" << endl;
+    Assignment() : orderId(0), agentId(0) {}
+    Assignment(int oid, int aid) : orderId(oid), agentId(aid) {}
+};
 
-        for (int i = 0; i < path.size(); i++)
+class AssignmentSolver
+{
+public:
+    static vector<int> solve(int rows, int cols, const vector<long long> &cost)
+    {
+        const long long UNREACHED = numeric_limits<long long>::max() / 4;
+        vector<long long> rowPotential(rows + 1, 0);
+        vector<long long> colPotential(cols + 1, 0);
+        vector<long long> slack(cols + 1);
+        vector<int> owner(cols + 1, 0);
+        vector<int> way(cols + 1, 0);
+        vector<bool> used(cols + 1);
+
+        for (int i = 1; i <= rows; i++)
         {
-            cout << "  " << (i + 1) << ". " << getNodeName(path[i]);
-            if (i < path.size() - 1)
+            owner[0] = i;
+            int j0 = 0;
+            fill(slack.begin(), slack.end(), UNREACHED);
+            fill(used.begin(), used.end(), false);
+
+            do
             {
-                string street = getStreetName(path[i], path[i + 1]);
-                int segmentDist = 0;
+                used[j0] = true;
+                int i0 = owner[j0];
+                const long long *row = &cost[(size_t)(i0 - 1) * cols];
+                long long delta = UNREACHED;
+                int j1 = 0;
 
-                Node<Edge> *temp = adjList[path[i]].getHead();
-                while (temp)
+                for (int j = 1; j <= cols; j++)
                 {
-                    if (temp->data.dest == path[i + 1])
+                    if (used[j])
+                        continue;
+                    long long reduced = row[j - 1] - rowPotential[i0] - colPotential[j];
+                    if (reduced < slack[j])
                     {
-                        segmentDist = temp->data.weight;
-                        break;
+                        slack[j] = reduced;
+                        way[j] = j0;
+                    }
+                    if (slack[j] < delta)
+                    {
+                        delta = slack[j];
+                        j1 = j;
                     }
-                    temp = temp->next;
                 }
 
-                cout << " --> [" << street << ", " << segmentDist << " km] -->";
+                for (int j = 0; j <= cols; j++)
+                {
+                    if (used[j])
+                    {
+                        rowPotential[owner[j]] += delta;
+                        colPotential[j] -= delta;
+                    }
+                    else
+                    {
+                        slack[j] -= delta;
+                    }
+                }
+                j0 = j1;
+            } while (owner[j0] != 0);
+
+            do
+            {
+                int j1 = way[j0];
+                owner[j0] = owner[j1];
+                j0 = j1;
+            } while (j0);
+        }
+
+        vector<int> assignment(rows, -1);
+        for (int j = 1; j <= cols; j++)
+        {
+            if (owner[j])
+            {
+                assignment[owner[j] - 1] = j - 1;
             }
-            cout << endl;
         }
-        cout << "===================================" << endl;
+        return assignment;
     }
+};
 
-    vector<int> dijkstra(int source)
+class WorkStealingPool
+{
+private:
+    struct WorkerQueue
     {
-        vector<int> dist(vertices, INF);
-        vector<bool> visited(vertices, false);
+        mutex lock;
+        deque<function<void()>> tasks;
+    };
 
-        dist[source] = 0;
+    vector<thread> threads;
+    vector<unique_ptr<WorkerQueue>> queues;
+    atomic<int> queued;
+    atomic<int> unfinished;
+    atomic<unsigned> nextQueue;
+    bool stopping;
+    mutex stateLock;
+    condition_variable workAvailable;
+    condition_variable allDone;
+
+    static int &currentWorker()
+    {
+        static thread_local int index = -1;
+        return index;
+    }
 
-        for (int count = 0; count < vertices - 1; count++)
+    bool takeTask(int self, function<void()> &task)
+    {
+        int n = queues.size();
+        for (int k = 0; k < n; k++)
         {
-            int u = -1;
-            int minDist = INF;
+            int victim = (self + k) % n;
+            WorkerQueue &q = *queues[victim];
+            lock_guard<mutex> guard(q.lock);
+            if (q.tasks.empty())
+                continue;
 
-            for (int i = 0; i < vertices; i++)
+            if (k == 0)
             {
-                if (!visited[i] && dist[i] < minDist)
-                {
-                    minDist = dist[i];
-                    u = i;
-                }
+                task = move(q.tasks.back());
+                q.tasks.pop_back();
             }
-
-            if (u == -1)
-                break;
-
-            visited[u] = true;
-
-            Node<Edge> *temp = adjList[u].getHead();
-            while (temp)
+            else
             {
-                int v = temp->data.dest;
-                int weight = temp->data.weight;
+                task = move(q.tasks.front());
+                q.tasks.pop_front();
+            }
+            queued--;
+            return true;
+        }
+        return false;
+    }
 
-                if (!visited[v] && dist[u] != INF && dist[u] + weight < dist[v])
+    void workerLoop(int self)
+    {
+        currentWorker() = self;
+        function<void()> task;
+        while (true)
+        {
+            if (takeTask(self, task))
+            {
+                task();
+                task = nullptr;
+                if (--unfinished == 0)
                 {
-                    dist[v] = dist[u] + weight;
+                    lock_guard<mutex> guard(stateLock);
+                    allDone.notify_all();
                 }
-                temp = temp->next;
+                continue;
             }
-        }
 
-        return dist;
+            unique_lock<mutex> guard(stateLock);
+            workAvailable.wait(guard, [this]() { return stopping || queued > 0; });
+            if (stopping && queued == 0)
+                return;
+        }
     }
 
-    int getVertices() { return vertices; }
+public:
+    WorkStealingPool(int workers) : queued(0), unfinished(0), nextQueue(0), stopping(false)
+    {
+        workers = max(1, workers);
+        for (int i = 0; i < workers; i++)
+        {
+            queues.push_back(unique_ptr<WorkerQueue>(new WorkerQueue()));
+        }
+        for (int i = 0; i < workers; i++)
+        {
+            threads.push_back(thread(&WorkStealingPool::workerLoop, this, i));
+        }
+    }
 
-    ~Graph()
+    ~WorkStealingPool()
     {
-        delete[] adjList;
+        {
+            lock_guard<mutex> guard(stateLock);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (thread &t : threads)
+        {
+            t.join();
+        }
     }
-};
 
-struct User
-{
-    int id;
-    string name;
-    int nodeId;
+    void submit(function<void()> task)
+    {
+        int self = currentWorker();
+        int target = self >= 0 ? self : nextQueue++ % queues.size();
+        unfinished++;
+        {
+            lock_guard<mutex> guard(queues[target]->lock);
+            queues[target]->tasks.push_back(move(task));
+        }
+        {
+            lock_guard<mutex> guard(stateLock);
+            queued++;
+        }
+        workAvailable.notify_one();
+    }
 
-    User() : id(0), name(""), nodeId(0) {}
-    User(int i, string n, int nid) : id(i), name(n), nodeId(nid) {}
+    void waitIdle()
+    {
+        unique_lock<mutex> guard(stateLock);
+        allDone.wait(guard, [this]() { return unfinished == 0; });
+    }
 
-    friend ostream &operator<<(ostream &os, const User &u)
+    template <typename Function>
+    void parallelFor(int count, Function body)
     {
-        os << "User ID: " << u.id << ", Name: " << u.name << ", Node: " << u.nodeId;
-        return os;
+        if (count <= 0)
+            return;
+
+        int chunk = max(1, count / (int)(queues.size() * 4));
+        for (int begin = 0; begin < count; begin += chunk)
+        {
+            int end = min(count, begin + chunk);
+            submit([begin, end, &body]()
+            {
+                for (int i = begin; i < end; i++)
+                {
+                    body(i);
+                }
+            });
+        }
+        waitIdle();
     }
+
+    int getWorkerCount() { return threads.size(); }
+    static int workerIndex() { return currentWorker(); }
 };
 
-struct Agent
+class JsonLineWriter
 {
-    int id;
-    string name;
-    int nodeId;
-    bool available;
+private:
+    FILE *file;
+    string text;
 
-    Agent() : id(0), name(""), nodeId(0), available(true) {}
-    Agent(int i, string n, int nid) : id(i), name(n), nodeId(nid), available(true) {}
+public:
+    static const size_t FLUSH_BYTES = 1 << 20;
 
-    friend ostream &operator<<(ostream &os, const Agent &a)
-    {
-        os << "Agent ID: " << a.id << ", Name: " << a.name
-           << ", Node: " << a.nodeId << ", Status: " << (a.available ? "Available" : "Busy");
-        return os;
-    }
-};
+    JsonLineWriter(FILE *f) : file(f) {}
+    ~JsonLineWriter() { flush(); }
 
-struct Order
-{
-    int orderId;
-    int userId;
-    int restaurantId;
-    int agentId;
-    int priority;
-    string status;
+    string &line() { return text; }
 
-    Order() : orderId(0), userId(0), restaurantId(0), agentId(-1), priority(0), status("Pending") {}
-    Order(int oid, int uid, int rid, int p)
-        : orderId(oid), userId(uid), restaurantId(rid), agentId(-1), priority(p), status("Pending") {}
+    void endLine()
+    {
+        text += '\n';
+        if (text.size() >= FLUSH_BYTES)
+        {
+            flush();
+        }
+    }
 
-    friend ostream &operator<<(ostream &os, const Order &o)
+    void flush()
     {
-        os << "Order ID: " << o.orderId << ", User: " << o.userId
-           << ", Restaurant: " << o.restaurantId << ", Agent: " << o.agentId
-           << ", Priority: " << o.priority << ", Status: " << o.status;
-        return os;
+        if (!text.empty())
+        {
+            fwrite(text.data(), 1, text.size(), file);
+            text.clear();
+        }
+        fflush(file);
     }
 };
 
-struct Assignment
+struct ReplayOptions
 {
-    int orderId;
-    int agentId;
+    int ordersPerTick;
+    int releaseTicks;
+    bool batch;
 
-    Assignment() : orderId(0), agentId(0) {}
-    Assignment(int oid, int aid) : orderId(oid), agentId(aid) {}
+    ReplayOptions() : ordersPerTick(1000), releaseTicks(1), batch(false) {}
 };
 
 class FoodDeliverySimulator
@@ -657,65 +3865,225 @@ private:
     Graph *graph;
     LinkedList<User> users;
     LinkedList<Agent> agents;
-    BST restaurants;
-    LinkedList<Order> orderHistory;
+    RestaurantIndex restaurants;
+    OrderStore orderHistory;
+    OrderJournal journal;
+    UserStore userStore;
+    thread compactor;
+    int snapshotRows;
+    IdIndex<User> userById;
+    IdIndex<Agent> agentById;
     PriorityQueue<Order> urgentOrders;
     Queue<Order> backlogOrders;
+    RingBuffer<Order> intake;
     Stack<Assignment> assignmentHistory;
 
-    int nextOrderId;
+    vector<Agent *> agentByRank;
+    AgentLocator agentLocator;
+    vector<int> zoneRestaurant;
+
+    WorkStealingPool *pool;
+    vector<Graph::SearchWorkspace> workspaces;
+    string dataDir;
+
+    struct DispatchPlan
+    {
+        Order order;
+        User *user;
+        int restaurantNode;
+        Agent *candidate;
+        vector<int> route;
+        int distance;
+    };
+
+    atomic<int> nextOrderId;
     int nextUserId;
     int numNodes;
+    bool useContractionHierarchy;
+    bool useDistanceTable;
+
+    JsonLineWriter *events;
+    vector<Agent *> dispatchedAgents;
+    int backlogLimit;
+    int replayTick;
+    bool persist;
+
+    static const int LANDMARK_COUNT = 8;
+    static const int INTAKE_CAPACITY = 1 << 14;
+    static const int JOURNAL_COMPACT_MIN = 4096;
+    static const int REPLAY_COMMIT_TICKS = 64;
+    static const int BATCH_ORDER_LIMIT = 256;
+    static const int BATCH_CANDIDATES = 8;
+
+    string dataPath(const string &file)
+    {
+        return dataDir.empty() ? file : dataDir + "/" + file;
+    }
 
 public:
-    FoodDeliverySimulator() : graph(nullptr), nextOrderId(1), nextUserId(1), numNodes(0)
+    FoodDeliverySimulator(string directory = "", bool buildHierarchy = true, bool buildTable = true, bool persistent = true)
+        : graph(nullptr), snapshotRows(0), intake(INTAKE_CAPACITY), pool(new WorkStealingPool(thread::hardware_concurrency())),
+          workspaces(pool->getWorkerCount() + 1), dataDir(directory),
+          nextOrderId(1), nextUserId(1), numNodes(0), useContractionHierarchy(buildHierarchy), useDistanceTable(buildTable),
+          events(nullptr), backlogLimit(5), replayTick(0), persist(persistent)
     {
-        loadGraph("nodes.csv", "edges.csv");
-        loadRestaurants("restaurants.csv");
-        clearUsersFile();
-        loadAgents("agents.csv");
-        loadOrderHistory("orders.csv");
+        loadGraph(dataPath("nodes.csv"), dataPath("edges.csv"));
+        loadRestaurants(dataPath("restaurants.csv"));
+        loadUsers(dataPath("users.csv"));
+        loadAgents(dataPath("agents.csv"));
+        loadOrderHistory(dataPath("orders.csv"));
     }
 
     ~FoodDeliverySimulator()
     {
-        saveOrderHistory("orders.csv");
+        if (persist)
+        {
+            if (!userStore.close())
+            {
+                cout << "Error: Could not save users to file." << endl;
+            }
+            journal.commit();
+            if (compactor.joinable())
+            {
+                compactor.join();
+            }
+            if (journal.getRecordCount() > 0 || DurableFile::exists(dataPath("orders.journal.compacting")))
+            {
+                compactOrderHistory(true);
+            }
+            journal.close();
+            if (journal.getRecordCount() == 0)
+            {
+                remove(dataPath("orders.journal").c_str());
+            }
+        }
+        delete pool;
         if (graph)
         {
             delete graph;
         }
     }
 
+    template <typename RowHandler>
+    static bool readCsv(const string &filename, bool hasHeader, int minFields, RowHandler onRow, bool report = true)
+    {
+        MappedFile file;
+        if (!file.open(filename))
+        {
+            return false;
+        }
+
+        CsvReader reader(file.view());
+        if (hasHeader)
+        {
+            reader.skipLine();
+        }
+
+        vector<string_view> fields;
+        while (reader.nextRow(fields))
+        {
+            if (((int)fields.size() < minFields || !onRow(fields)) && report)
+            {
+                reportMalformed(filename, reader.getLine());
+            }
+        }
+        return true;
+    }
+
+    static void reportMalformed(const string &filename, int line)
+    {
+        cout << "Warning: skipping malformed row at " << filename << ":" << line << endl;
+    }
+
     void loadGraph(string nodesFile, string edgesFile)
     {
-        ifstream nodeIn(nodesFile);
-        if (!nodeIn)
+        numNodes = 0;
+        string snapshotFile = dataPath("graph.bin");
+        long long snapshotTime = DurableFile::modifiedAt(snapshotFile);
+        if (snapshotTime > DurableFile::modifiedAt(nodesFile) && snapshotTime > DurableFile::modifiedAt(edgesFile))
+        {
+            graph = Graph::openSnapshot(snapshotFile);
+            if (!graph)
+            {
+                cout << "Warning: ignoring invalid graph snapshot: " << snapshotFile << endl;
+            }
+        }
+
+        if (graph)
+        {
+            numNodes = graph->getVertices();
+        }
+        else if (!loadGraphCsv(nodesFile, edgesFile))
         {
-            cout << "Error: Could not open nodes file: " << nodesFile << endl;
             return;
         }
+        else if (!graph->saveSnapshot(snapshotFile))
+        {
+            cout << "Warning: could not write graph snapshot: " << snapshotFile << endl;
+        }
 
-        string line;
-        getline(nodeIn, line);
+        if (useContractionHierarchy)
+        {
+            graph->buildContractionHierarchy();
+        }
+        if (useDistanceTable && !graph->buildDistanceTable())
+        {
+            cout << "Warning: graph too large for the distance table; routing uses the hierarchy or Dijkstra instead." << endl;
+        }
+        graph->buildLandmarks(LANDMARK_COUNT);
 
-        numNodes = 0;
-        vector<string> nodeNames;
-        vector<string> nodeTypes;
+        cout << "Graph loaded successfully with " << numNodes << " nodes." << endl;
+    }
+
+    bool loadGraphCsv(const string &nodesFile, const string &edgesFile)
+    {
+        vector<string_view> nodeNames;
+        vector<string_view> nodeTypes;
 
-        while (getline(nodeIn, line))
+        MappedFile nodeFile;
+        if (!nodeFile.open(nodesFile))
         {
-            stringstream ss(line);
-            string id, name, type;
+            cout << "Error: Could not open nodes file: " << nodesFile << endl;
+            return false;
+        }
 
-            getline(ss, id, ',');
-            getline(ss, name, ',');
-            getline(ss, type, ',');
+        CsvReader nodeReader(nodeFile.view());
+        nodeReader.skipLine();
+        vector<string_view> fields;
+        vector<int> nodeIds;
+        vector<int> nodeLines;
+        while (nodeReader.nextRow(fields))
+        {
+            int nodeId = -1;
+            if (fields.size() < 2 || !CsvReader::parseInt(fields[0], nodeId))
+            {
+                nodeId = -1;
+            }
+            nodeIds.push_back(nodeId);
+            nodeLines.push_back(nodeReader.getLine());
+            nodeNames.push_back(fields.size() > 1 ? fields[1] : string_view());
+            nodeTypes.push_back(fields.size() > 2 ? fields[2] : string_view());
+        }
 
-            nodeNames.push_back(name);
-            nodeTypes.push_back(type);
-            numNodes++;
+        // Every row keeps a slot, so a malformed row cannot shift the ids of the nodes after it
+        numNodes = nodeIds.size();
+        vector<string_view> names(numNodes);
+        vector<string_view> types(numNodes);
+        vector<bool> seen(numNodes, false);
+        for (int i = 0; i < numNodes; i++)
+        {
+            int nodeId = nodeIds[i];
+            if (nodeId < 0 || nodeId >= numNodes || seen[nodeId])
+            {
+                reportMalformed(nodesFile, nodeLines[i]);
+                continue;
+            }
+            seen[nodeId] = true;
+            names[nodeId] = nodeNames[i];
+            types[nodeId] = nodeTypes[i];
         }
-        nodeIn.close();
+        nodeNames.swap(names);
+        nodeTypes.swap(types);
 
         graph = new Graph(numNodes);
 
@@ -724,117 +4092,121 @@ public:
             graph->setNodeInfo(i, nodeNames[i], nodeTypes[i]);
         }
 
-        ifstream edgeIn(edgesFile);
-        if (!edgeIn)
+        MappedFile edgeFile;
+        if (!edgeFile.open(edgesFile))
         {
             cout << "Error: Could not open edges file: " << edgesFile << endl;
-            return;
+            return false;
         }
 
-        getline(edgeIn, line);
-
-        while (getline(edgeIn, line))
+        struct ParsedEdge
         {
-            stringstream ss(line);
-            string src, dest, weight, streetName;
-
-            getline(ss, src, ',');
-            getline(ss, dest, ',');
-            getline(ss, weight, ',');
-            getline(ss, streetName, ',');
+            int src;
+            int dest;
+            int weight;
+            string_view street;
+        };
+
+        CsvReader edgeHeader(edgeFile.view());
+        edgeHeader.skipLine();
+        vector<string_view> chunks = CsvReader::splitAtLines(edgeHeader.rest(), 4 * pool->getWorkerCount());
+        vector<vector<ParsedEdge>> parsed(chunks.size());
+        vector<vector<int>> badLines(chunks.size());
+        vector<int> lineCounts(chunks.size());
+
+        pool->parallelFor(chunks.size(), [&](int c)
+        {
+            CsvReader reader(chunks[c]);
+            vector<string_view> row;
+            while (reader.nextRow(row))
+            {
+                ParsedEdge edge;
+                if (row.size() >= 3 && CsvReader::parseInt(row[0], edge.src) && CsvReader::parseInt(row[1], edge.dest) &&
+                    CsvReader::parseInt(row[2], edge.weight) && edge.weight >= 0 && edge.src >= 0 && edge.src < numNodes &&
+                    edge.dest >= 0 && edge.dest < numNodes)
+                {
+                    edge.street = row.size() > 3 ? row[3] : string_view();
+                    parsed[c].push_back(edge);
+                }
+                else
+                {
+                    badLines[c].push_back(reader.getLine());
+                }
+            }
+            lineCounts[c] = reader.getLine();
+        });
 
-            graph->addEdge(stoi(src), stoi(dest), stoi(weight), streetName);
+        int lineBase = 1;
+        for (int c = 0; c < (int)chunks.size(); c++)
+        {
+            for (int line : badLines[c])
+            {
+                reportMalformed(edgesFile, lineBase + line);
+            }
+            for (const ParsedEdge &edge : parsed[c])
+            {
+                graph->addEdge(edge.src, edge.dest, edge.weight, edge.street);
+            }
+            lineBase += lineCounts[c];
         }
-        edgeIn.close();
-
-        cout << "Graph loaded successfully with " << numNodes << " nodes." << endl;
+        graph->freeze();
+        return true;
     }
 
     void loadRestaurants(string filename)
     {
-        ifstream file(filename);
-        if (!file)
+        vector<Restaurant> loaded;
+        bool opened = readCsv(filename, true, 3, [&](const vector<string_view> &fields)
+        {
+            int id, nodeId;
+            if (!CsvReader::parseInt(fields[0], id) || !CsvReader::parseInt(fields[2], nodeId) || !validNode(nodeId))
+                return false;
+            loaded.push_back(Restaurant(id, fields[1], nodeId));
+            return true;
+        });
+        if (!opened)
         {
             cout << "Error: Could not open file: " << filename << endl;
             return;
         }
-
-        string line;
-        getline(file, line);
-
-        while (getline(file, line))
-        {
-            stringstream ss(line);
-            string id, name, nodeId;
-
-            getline(ss, id, ',');
-            getline(ss, name, ',');
-            getline(ss, nodeId, ',');
-
-            Restaurant r(stoi(id), name, stoi(nodeId));
-            restaurants.insert(r);
-        }
-        file.close();
+        restaurants.load(move(loaded));
 
         cout << "Restaurants loaded successfully." << endl;
     }
 
-    void clearUsersFile()
-    {
-        ofstream file("users.csv", ios::trunc);
-        if (file)
-        {
-            file << "id,name,nodeId\n";
-            file.close();
-            cout << "Users file cleared successfully." << endl;
-        }
-        else
-        {
-            cout << "Error: Could not clear users file." << endl;
-        }
-    }
-
     void loadUsers(string filename)
     {
-        ifstream file(filename);
-        if (!file)
+        bool opened = !DurableFile::exists(filename) || readCsv(filename, true, 3, [&](const vector<string_view> &fields)
+        {
+            int id, nodeId;
+            if (!CsvReader::parseInt(fields[0], id) || !CsvReader::parseInt(fields[2], nodeId) || !validNode(nodeId) ||
+                userById.find(id))
+                return false;
+            User *user = users.emplace(id, fields[1], nodeId);
+            userById.put(user->id, user);
+            nextUserId = max(nextUserId, id + 1);
+            return true;
+        });
+        if (!opened || (persist && !userStore.open(filename)))
         {
             cout << "Error: Could not open file: " << filename << endl;
             return;
         }
 
-        string line;
-        getline(file, line);
-
-        while (getline(file, line))
-        {
-            stringstream ss(line);
-            string id, name, nodeId;
-
-            getline(ss, id, ',');
-            getline(ss, name, ',');
-            getline(ss, nodeId, ',');
-
-            users.insert(User(stoi(id), name, stoi(nodeId)));
-        }
-        file.close();
-
         cout << "Users loaded successfully." << endl;
     }
 
     int addUser(string name, int nodeId)
     {
+        replace(name.begin(), name.end(), ',', ' ');
+        replace(name.begin(), name.end(), '\n', ' ');
+        replace(name.begin(), name.end(), '\r', ' ');
+
         int userId = nextUserId++;
-        User newUser(userId, name, nodeId);
-        users.insert(newUser);
+        User *user = users.emplace(userId, name, nodeId);
+        userById.put(userId, user);
 
-        ofstream file("users.csv", ios::app);
-        if (file)
-        {
-            file << userId << "," << name << "," << nodeId << "\n";
-            file.close();
-        }
-        else
+        if (persist && !userStore.stage(*user))
         {
             cout << "Error: Could not save user to file." << endl;
         }
@@ -844,99 +4216,172 @@ public:
 
     void loadAgents(string filename)
     {
-        ifstream file(filename);
-        if (!file)
+        bool opened = readCsv(filename, true, 3, [&](const vector<string_view> &fields)
+        {
+            int id, nodeId;
+            if (!CsvReader::parseInt(fields[0], id) || !CsvReader::parseInt(fields[2], nodeId) || !validNode(nodeId))
+                return false;
+            Agent *agent = agents.emplace(id, fields[1], nodeId);
+            agentById.put(agent->id, agent);
+            return true;
+        });
+        if (!opened)
         {
             cout << "Error: Could not open file: " << filename << endl;
             return;
         }
 
-        string line;
-        getline(file, line);
+        indexAgents();
 
-        while (getline(file, line))
-        {
-            stringstream ss(line);
-            string id, name, nodeId;
+        cout << "Agents loaded successfully." << endl;
+    }
+
+    void indexAgents()
+    {
+        agentByRank.clear();
 
-            getline(ss, id, ',');
-            getline(ss, name, ',');
-            getline(ss, nodeId, ',');
+        Node<Agent> *temp = agents.getHead();
+        while (temp)
+        {
+            temp->data.rank = agentByRank.size();
+            agentByRank.push_back(&(temp->data));
+            temp = temp->next;
+        }
 
-            agents.insert(Agent(stoi(id), name, stoi(nodeId)));
+        vector<int> sources;
+        zoneRestaurant.clear();
+        for (int i = 0; i < restaurants.getSize(); i++)
+        {
+            sources.push_back(restaurants.at(i).nodeId);
+            zoneRestaurant.push_back(restaurants.at(i).id);
         }
-        file.close();
+        vector<int> zones = graph ? graph->partitionByNearest(sources) : vector<int>(numNodes, -1);
+        agentLocator.build(agentByRank, zones, sources.size());
+    }
 
-        cout << "Agents loaded successfully." << endl;
+    bool validNode(int nodeId)
+    {
+        return nodeId >= 0 && nodeId < numNodes;
+    }
+
+    bool hasAvailableAgent(int node)
+    {
+        return agentLocator.hasAvailableAt(node);
     }
 
     void loadOrderHistory(string filename)
     {
-        ifstream file(filename);
-        if (!file)
+        snapshotRows = readOrders(filename, true);
+        int replayed = readOrders(dataPath("orders.journal.compacting"), false);
+        replayed += readOrders(dataPath("orders.journal"), false);
+
+        if (persist && !journal.open(dataPath("orders.journal"), replayed))
         {
-            return;
+            cout << "Error: Could not open order journal " << dataPath("orders.journal") << endl;
         }
+    }
 
-        string line;
-        getline(file, line);
+    int readOrders(string filename, bool hasHeader)
+    {
+        int maxOrderId = nextOrderId - 1;
+        int count = readOrders(orderHistory, filename, hasHeader, maxOrderId, true);
+        nextOrderId = maxOrderId + 1;
+        return count;
+    }
 
-        while (getline(file, line))
+    static int readOrders(OrderStore &store, const string &filename, bool hasHeader, int &maxOrderId, bool report)
+    {
+        int count = 0;
+        readCsv(filename, hasHeader, 5, [&](const vector<string_view> &fields)
         {
-            if (line.empty())
-                continue;
-
-            stringstream ss(line);
-            string orderId, userId, restaurantId, agentId, priority, status;
-
-            getline(ss, orderId, ',');
-            getline(ss, userId, ',');
-            getline(ss, restaurantId, ',');
-            getline(ss, agentId, ',');
-            getline(ss, priority, ',');
-            getline(ss, status, ',');
+            int orderId, userId, restaurantId, agentId, priority;
+            if (!CsvReader::parseInt(fields[0], orderId) || !CsvReader::parseInt(fields[1], userId) ||
+                !CsvReader::parseInt(fields[2], restaurantId) || !CsvReader::parseInt(fields[3], agentId) ||
+                !CsvReader::parseInt(fields[4], priority) || !Order::validPriority(priority))
+                return false;
+
+            Order order(orderId, userId, restaurantId, priority);
+            order.agentId = agentId;
+            order.status = parseStatus(fields.size() > 5 ? fields[5] : string_view());
+
+            store.put(order);
+            count++;
+            maxOrderId = max(maxOrderId, order.orderId);
+            return true;
+        }, report);
+        return count;
+    }
 
-            Order order;
-            order.orderId = stoi(orderId);
-            order.userId = stoi(userId);
-            order.restaurantId = stoi(restaurantId);
-            order.agentId = stoi(agentId);
-            order.priority = stoi(priority);
-            order.status = status;
+    static bool writeOrderSnapshot(const OrderStore &store, const string &filename)
+    {
+        string temp = filename + ".tmp";
+        DurableFile file;
+        if (!file.open(temp, true))
+        {
+            return false;
+        }
 
-            orderHistory.insert(order);
+        bool ok = file.write("orderId,userId,restaurantId,agentId,priority,status\n");
+        store.save([&](const string &chunk) { ok = ok && file.write(chunk); });
+        ok = ok && file.sync();
+        file.close();
+        return ok && DurableFile::replace(temp, filename);
+    }
 
-            if (order.orderId >= nextOrderId)
-            {
-                nextOrderId = order.orderId + 1;
-            }
+    void commitOrders()
+    {
+        if (!persist)
+        {
+            return;
+        }
+        // Orders reference their users, so the users must reach disk first
+        if (!userStore.flush())
+        {
+            cout << "Error: Could not save users to file." << endl;
+        }
+        if (!journal.commit())
+        {
+            cout << "Error: Could not write order journal " << dataPath("orders.journal") << endl;
+        }
+        if (journal.getRecordCount() >= max(JOURNAL_COMPACT_MIN, snapshotRows))
+        {
+            compactOrderHistory(false);
         }
-        file.close();
     }
 
-    void saveOrderHistory(string filename)
+    void compactOrderHistory(bool wait)
     {
-        ofstream file(filename);
-        if (!file)
+        if (compactor.joinable())
         {
-            cout << "Error: Could not save order history to " << filename << endl;
+            compactor.join();
+        }
+
+        string archive = dataPath("orders.journal.compacting");
+        if (!DurableFile::exists(archive) && !journal.rotate(archive) && !DurableFile::exists(archive))
+        {
+            cout << "Error: Could not rotate order journal " << dataPath("orders.journal") << endl;
             return;
         }
+        journal.commit();
 
-        file << "orderId,userId,restaurantId,agentId,priority,status" << endl;
+        snapshotRows = orderHistory.getSize();
+        string snapshotPath = dataPath("orders.csv");
+        compactor = thread([snapshotPath, archive]()
+        {
+            OrderStore snapshot;
+            int maxOrderId = 0;
+            readOrders(snapshot, snapshotPath, true, maxOrderId, false);
+            readOrders(snapshot, archive, false, maxOrderId, false);
+            if (writeOrderSnapshot(snapshot, snapshotPath))
+            {
+                remove(archive.c_str());
+            }
+        });
 
-        Node<Order> *temp = orderHistory.getHead();
-        while (temp)
+        if (wait)
         {
-            file << temp->data.orderId << ","
-                 << temp->data.userId << ","
-                 << temp->data.restaurantId << ","
-                 << temp->data.agentId << ","
-                 << temp->data.priority << ","
-                 << temp->data.status << endl;
-            temp = temp->next;
+            compactor.join();
         }
-        file.close();
     }
 
     void displayRestaurants()
@@ -946,6 +4391,26 @@ public:
         cout << "=====================================" << endl;
     }
 
+    void searchRestaurants()
+    {
+        string prefix;
+        cout << "\nEnter restaurant name or prefix: ";
+        getline(cin, prefix);
+
+        vector<Restaurant *> matches = restaurants.withPrefix(prefix);
+
+        cout << "\n========== Matching Restaurants ==========" << endl;
+        if (matches.empty())
+        {
+            cout << "No restaurants match \"" << prefix << "\"." << endl;
+        }
+        for (Restaurant *r : matches)
+        {
+            cout << *r << endl;
+        }
+        cout << "==========================================" << endl;
+    }
+
     void displayUsers()
     {
         cout << "\n========== All Users ==========" << endl;
@@ -957,6 +4422,12 @@ public:
     {
         cout << "\n========== All Agents ==========" << endl;
         agents.display();
+        cout << "\nFree agents by zone (nearest restaurant):" << endl;
+        for (int zone = 0; zone < agentLocator.getZoneCount(); zone++)
+        {
+            Restaurant *restaurant = restaurants.findById(zoneRestaurant[zone]);
+            cout << "  " << StringPool::view(restaurant->name) << ": " << agentLocator.freeInZoneCount(zone) << endl;
+        }
         cout << "================================" << endl;
     }
 
@@ -981,76 +4452,372 @@ public:
         cout << "Select delivery point (1, 3, 5, 7, or 8): ";
         cin >> nodeId;
 
-        if (nodeId != 1 && nodeId != 3 && nodeId != 5 && nodeId != 7 && nodeId != 8)
+        if (nodeId != 1 && nodeId != 3 && nodeId != 5 && nodeId != 7 && nodeId != 8)
+        {
+            cout << "\nError: Invalid delivery point! Please select from the available options." << endl;
+            return;
+        }
+
+        int userId = addUser(userName, nodeId);
+        cout << "\nUser created successfully!" << endl;
+        cout << "User ID: " << userId << endl;
+        cout << "Delivery Location: " << graph->getNodeName(nodeId) << endl;
+
+        cout << "\nAvailable Restaurants in Karachi:" << endl;
+        displayRestaurants();
+
+        cout << "\nEnter Restaurant ID (1-5): ";
+        cin >> restaurantId;
+
+        if (restaurantId < 1 || restaurantId > 5)
+        {
+            cout << "\nError: Invalid restaurant ID! Must be between 1 and 5." << endl;
+            return;
+        }
+
+        cout << "Enter Priority (1-10, >=5 is urgent): ";
+        cin >> priority;
+
+        if (!Order::validPriority(priority))
+        {
+            cout << "\nError: Invalid priority! Must be between 1 and 10." << endl;
+            return;
+        }
+
+        Order order = placeOrder(userId, restaurantId, priority);
+
+        if (priority >= 5)
+        {
+            cout << "\nUrgent order created and added to priority queue." << endl;
+        }
+        else
+        {
+            cout << "\nRegular order created and added to backlog queue." << endl;
+        }
+
+        cout << order << endl;
+    }
+
+    Order placeOrder(int userId, int restaurantId, int priority)
+    {
+        Order order(nextOrderId++, userId, restaurantId, priority);
+        enqueuePending(order);
+        return order;
+    }
+
+    void enqueuePending(Order order)
+    {
+        if (order.priority >= 5)
+        {
+            int priority = order.priority;
+            urgentOrders.enqueue(move(order), priority);
+        }
+        else
+        {
+            backlogOrders.enqueue(move(order));
+        }
+    }
+
+    bool submitOrder(int userId, int restaurantId, int priority)
+    {
+        return intake.tryPush(Order(0, userId, restaurantId, priority));
+    }
+
+    int drainIntake()
+    {
+        return intake.drain([this](Order order)
+        {
+            order.orderId = nextOrderId++;
+            enqueuePending(move(order));
+        }, intake.getCapacity());
+    }
+
+    Graph *getGraph() { return graph; }
+
+    Agent *findNearestAgent(int restaurantNode)
+    {
+        if (!graph)
+        {
+            cout << "Graph not loaded!" << endl;
+            return nullptr;
+        }
+
+        int minDist;
+        int worker = WorkStealingPool::workerIndex();
+        Graph::SearchWorkspace &workspace = workspaces[worker >= 0 ? worker : workspaces.size() - 1];
+        const vector<int> &nodes = graph->nearestMatching(restaurantNode, [this](int v) { return hasAvailableAgent(v); },
+                                                          minDist, workspace);
+
+        Agent *best = nullptr;
+        for (int v : nodes)
+        {
+            Agent *agent = agentLocator.lowestRankAt(v);
+            if (agent && (!best || agent->rank < best->rank))
+            {
+                best = agent;
+            }
+        }
+
+        return best;
+    }
+
+    int restaurantNodeFor(const Order &order)
+    {
+        Restaurant *restaurant = restaurants.findById(order.restaurantId);
+        return restaurant ? restaurant->nodeId : -1;
+    }
+
+    DispatchPlan planFor(const Order &order)
+    {
+        DispatchPlan plan;
+        plan.order = order;
+        plan.user = userById.find(order.userId);
+        plan.restaurantNode = restaurantNodeFor(order);
+        plan.candidate = nullptr;
+        plan.distance = INF;
+        return plan;
+    }
+
+    void planDispatch(vector<DispatchPlan> &plans, int begin, int end)
+    {
+        if (agentLocator.freeCount() == 0)
+            return;
+
+        graph->prepareForQueries();
+        pool->parallelFor(end - begin, [&](int i)
+        {
+            DispatchPlan &plan = plans[begin + i];
+            if (!plan.user || plan.restaurantNode < 0)
+                return;
+            plan.candidate = findNearestAgent(plan.restaurantNode);
+            if (plan.candidate)
+            {
+                plan.distance = graph->shortestRoute(plan.restaurantNode, plan.user->nodeId, plan.route);
+            }
+        });
+    }
+
+    Agent *claimAgent(DispatchPlan &plan)
+    {
+        if (plan.candidate && !plan.candidate->available)
+        {
+            plan.candidate = findNearestAgent(plan.restaurantNode);
+        }
+        return plan.candidate;
+    }
+
+    void completeAssignment(Order &order, User *user, Agent *agent, int restaurantNode,
+                            const vector<int> &route, int distance, const string &label)
+    {
+        order.agentId = agent->id;
+        order.status = ORDER_ASSIGNED;
+        agentLocator.setAvailable(agent, false);
+
+        orderHistory.put(order);
+        if (persist)
         {
-            cout << "\nError: Invalid delivery point! Please select from the available options." << endl;
+            journal.stage(order);
+        }
+        assignmentHistory.emplace(order.orderId, agent->id);
+
+        int eta = (distance * 60) / 30;
+        if (events)
+        {
+            dispatchedAgents.push_back(agent);
+            string &out = events->line();
+            out += "{\"event\":\"assigned\",\"tick\":";
+            out += to_string(replayTick);
+            out += ",\"order\":";
+            out += to_string(order.orderId);
+            out += ",\"user\":";
+            out += to_string(order.userId);
+            out += ",\"restaurant\":";
+            out += to_string(order.restaurantId);
+            out += ",\"agent\":";
+            out += to_string(agent->id);
+            out += ",\"priority\":";
+            out += to_string(order.priority);
+            out += ",\"queue\":\"";
+            out += label == "URGENT" ? "urgent" : "backlog";
+            out += "\",\"distance\":";
+            out += to_string(distance);
+            out += ",\"eta\":";
+            out += to_string(eta);
+            out += ",\"route\":[";
+            for (int i = 0; i < (int)route.size(); i++)
+            {
+                if (i > 0)
+                    out += ',';
+                out += to_string(route[i]);
+            }
+            out += "]}";
+            events->endLine();
             return;
         }
 
-        int userId = addUser(userName, nodeId);
-        cout << "\nUser created successfully!" << endl;
-        cout << "User ID: " << userId << endl;
-        cout << "Delivery Location: " << graph->getNodeName(nodeId) << endl;
+        cout << "\n============================================" << endl;
+        cout << "     ORDER DISPATCHED SUCCESSFULLY!        " << endl;
+        cout << "============================================" << endl;
 
-        cout << "\nAvailable Restaurants in Karachi:" << endl;
-        displayRestaurants();
+        cout << "\n[" << label << " ORDER #" << order.orderId << "]" << endl;
+        cout << "Customer: " << StringPool::view(user->name) << endl;
+        cout << "Restaurant: " << graph->getNodeName(restaurantNode) << endl;
+        cout << "Agent: " << StringPool::view(agent->name) << endl;
+        cout << "Distance: " << distance << " km" << endl;
+        cout << "ETA: " << eta << " minutes" << endl;
 
-        cout << "\nEnter Restaurant ID (1-5): ";
-        cin >> restaurantId;
+        graph->displayRoute(restaurantNode, user->nodeId, route, distance);
+    }
 
-        if (restaurantId < 1 || restaurantId > 5)
+    void reportRejected(const Order &order, const char *subject, const char *reason)
+    {
+        if (events)
         {
-            cout << "\nError: Invalid restaurant ID! Must be between 1 and 5." << endl;
+            string &out = events->line();
+            out += "{\"event\":\"rejected\",\"tick\":";
+            out += to_string(replayTick);
+            out += ",\"order\":";
+            out += to_string(order.orderId);
+            out += ",\"reason\":\"";
+            out += reason;
+            out += "\"}";
+            events->endLine();
             return;
         }
+        cout << subject << " not found for order " << order.orderId << endl;
+    }
 
-        cout << "Enter Priority (1-10, >=5 is urgent): ";
-        cin >> priority;
-
-        Order order(nextOrderId++, userId, restaurantId, priority);
+    void reportDeferred(const Order &order)
+    {
+        if (events)
+        {
+            string &out = events->line();
+            out += "{\"event\":\"deferred\",\"tick\":";
+            out += to_string(replayTick);
+            out += ",\"order\":";
+            out += to_string(order.orderId);
+            out += '}';
+            events->endLine();
+            return;
+        }
+        cout << "\nNo agent available for urgent order " << order.orderId << ". Moving to backlog." << endl;
+    }
 
-        if (priority >= 5)
+    void reportDispatched(int dispatched)
+    {
+        if (events)
         {
-            urgentOrders.enqueue(order, priority);
-            cout << "\nUrgent order created and added to priority queue." << endl;
+            return;
+        }
+        if (dispatched > 0)
+        {
+            cout << "\n>> " << dispatched << " order(s) dispatched successfully!" << endl;
+            commitOrders();
         }
         else
         {
-            backlogOrders.enqueue(order);
-            cout << "\nRegular order created and added to backlog queue." << endl;
+            cout << "\nNo orders dispatched. No available agents or no pending orders." << endl;
         }
-
-        cout << order << endl;
     }
 
-    Agent *findNearestAgent(int restaurantNode)
+    void dispatchOrders()
     {
         if (!graph)
         {
-            cout << "Graph not loaded!" << endl;
-            return nullptr;
+            cout << "Graph not loaded! Cannot dispatch orders." << endl;
+            return;
         }
 
-        vector<int> distances = graph->dijkstra(restaurantNode);
+        drainIntake();
 
-        Agent *nearestAgent = nullptr;
-        int minDist = INF;
+        int dispatched = 0;
 
-        Node<Agent> *temp = agents.getHead();
-        while (temp)
+        vector<DispatchPlan> urgent;
+        while (!urgentOrders.isEmpty())
+        {
+            urgent.push_back(planFor(urgentOrders.dequeue()));
+        }
+        planDispatch(urgent, 0, urgent.size());
+
+        for (DispatchPlan &plan : urgent)
         {
-            if (temp->data.available && distances[temp->data.nodeId] < minDist)
+            if (!plan.user)
             {
-                minDist = distances[temp->data.nodeId];
-                nearestAgent = &(temp->data);
+                reportRejected(plan.order, "User", "user_not_found");
+                continue;
+            }
+            if (plan.restaurantNode < 0)
+            {
+                reportRejected(plan.order, "Restaurant", "restaurant_not_found");
+                continue;
+            }
+
+            Agent *agent = claimAgent(plan);
+
+            if (agent)
+            {
+                completeAssignment(plan.order, plan.user, agent, plan.restaurantNode, plan.route, plan.distance, "URGENT");
+                dispatched++;
+            }
+            else
+            {
+                reportDeferred(plan.order);
+                backlogOrders.enqueue(move(plan.order));
+            }
+        }
+
+        int backlogProcessed = 0;
+        int chunkSize = 4 * pool->getWorkerCount();
+        Queue<Order>::Sweep sweep = backlogOrders.sweep();
+
+        while (!sweep.done() && backlogProcessed < backlogLimit && agentLocator.freeCount() > 0)
+        {
+            vector<DispatchPlan> chunk;
+            for (Node<Order> *node = sweep.node(); node && (int)chunk.size() < chunkSize; node = node->next)
+            {
+                chunk.push_back(planFor(node->data));
+            }
+            planDispatch(chunk, 0, chunk.size());
+
+            for (DispatchPlan &plan : chunk)
+            {
+                if (backlogProcessed >= backlogLimit || agentLocator.freeCount() == 0)
+                {
+                    break;
+                }
+                if (!plan.user)
+                {
+                    reportRejected(plan.order, "User", "user_not_found");
+                    sweep.take();
+                    continue;
+                }
+                if (plan.restaurantNode < 0)
+                {
+                    reportRejected(plan.order, "Restaurant", "restaurant_not_found");
+                    sweep.take();
+                    continue;
+                }
+
+                Agent *agent = claimAgent(plan);
+
+                if (agent)
+                {
+                    sweep.take();
+                    completeAssignment(plan.order, plan.user, agent, plan.restaurantNode, plan.route, plan.distance, "BACKLOG");
+                    dispatched++;
+                    backlogProcessed++;
+                }
+                else
+                {
+                    sweep.retain();
+                }
             }
-            temp = temp->next;
         }
 
-        return nearestAgent;
+        reportDispatched(dispatched);
     }
 
-    void dispatchOrders()
+    void dispatchOrdersBatch()
     {
         if (!graph)
         {
@@ -1058,131 +4825,333 @@ public:
             return;
         }
 
-        int dispatched = 0;
+        drainIntake();
 
-        while (!urgentOrders.isEmpty())
+        vector<Order> pending;
+        vector<bool> fromBacklog;
+        vector<User *> customers;
+        vector<Order> retry;
+
+        bool agentsFree = agentLocator.freeCount() > 0;
+        while (!urgentOrders.isEmpty() ||
+               (agentsFree && (int)pending.size() < BATCH_ORDER_LIMIT && !backlogOrders.isEmpty()))
         {
-            Order order = urgentOrders.dequeue();
+            bool backlog = urgentOrders.isEmpty();
+            Order order = backlog ? backlogOrders.dequeue() : urgentOrders.dequeue();
 
-            User *user = users.find(order.userId);
+            User *user = userById.find(order.userId);
             if (!user)
             {
-                cout << "User not found for order " << order.orderId << endl;
+                reportRejected(order, "User", "user_not_found");
                 continue;
             }
+            if (restaurantNodeFor(order) < 0)
+            {
+                reportRejected(order, "Restaurant", "restaurant_not_found");
+                continue;
+            }
+            if (!agentsFree || (int)pending.size() >= BATCH_ORDER_LIMIT)
+            {
+                reportDeferred(order);
+                retry.push_back(order);
+                continue;
+            }
+            pending.push_back(order);
+            fromBacklog.push_back(backlog);
+            customers.push_back(user);
+        }
 
-            int restaurantNode = order.restaurantId - 1;
-
-            Agent *agent = findNearestAgent(restaurantNode);
+        vector<Agent *> freeAgents;
+        for (Agent *agent : agentByRank)
+        {
+            if (agent->available && validNode(agent->nodeId))
+            {
+                freeAgents.push_back(agent);
+            }
+        }
 
-            if (agent)
+        // Each order only competes for its nearest free agents
+        int orders = pending.size();
+        int agentCount = freeAgents.size();
+        int k = min(BATCH_CANDIDATES, agentCount);
+        vector<int> nearest((size_t)orders * k);
+        vector<int> nearestDistance((size_t)orders * k);
+        graph->prepareForQueries();
+        pool->parallelFor(k > 0 ? orders : 0, [&](int i)
+        {
+            shared_ptr<const ShortestPathTree> tree = graph->shortestPathTree(restaurantNodeFor(pending[i]));
+            vector<pair<int, int>> byDistance(agentCount);
+            for (int j = 0; j < agentCount; j++)
+            {
+                byDistance[j] = make_pair(tree->dist[freeAgents[j]->nodeId], j);
+            }
+            partial_sort(byDistance.begin(), byDistance.begin() + k, byDistance.end());
+            for (int c = 0; c < k; c++)
+            {
+                nearestDistance[(size_t)i * k + c] = byDistance[c].first;
+                nearest[(size_t)i * k + c] = byDistance[c].second;
+            }
+        });
+
+        vector<int> weight(orders);
+        vector<int> column(agentCount, -1);
+        vector<int> candidates;
+        long long maxWeight = 1;
+        long long maxDistance = 0;
+        for (int i = 0; i < orders; i++)
+        {
+            weight[i] = max(1, (int)pending[i].priority);
+            maxWeight = max(maxWeight, (long long)weight[i]);
+            for (int c = 0; c < k; c++)
             {
-                order.agentId = agent->id;
-                order.status = "Assigned";
-                agent->available = false;
+                int d = nearestDistance[(size_t)i * k + c];
+                int agent = nearest[(size_t)i * k + c];
+                if (d == INF)
+                    continue;
+                maxDistance = max(maxDistance, (long long)d);
+                if (column[agent] == -1)
+                {
+                    column[agent] = candidates.size();
+                    candidates.push_back(agent);
+                }
+            }
+        }
 
-                auto result = graph->dijkstraWithPath(restaurantNode, user->nodeId);
-                vector<int> distances = result.first;
-                vector<int> parent = result.second;
-                int distance = distances[user->nodeId];
-                int eta = (distance * 60) / 30;
+        // The smaller side becomes the rows and gets one dummy "unassigned" column per row. An unassigned
+        // order costs more than any total distance, so the most priority weight is matched first either way.
+        int agentCols = candidates.size();
+        bool orderRows = orders <= agentCols;
+        int rows = orderRows ? orders : agentCols;
+        int cols = orders + agentCols;
+        long long unassignedUnit = (maxDistance + 1) * maxWeight * (rows + 1);
+        long long forbidden = unassignedUnit * (maxWeight + 1);
+        vector<long long> cost((size_t)rows * cols, forbidden);
+        for (int r = 0; r < rows; r++)
+        {
+            for (int j = orderRows ? agentCols : orders; j < cols; j++)
+            {
+                cost[(size_t)r * cols + j] = orderRows ? unassignedUnit * weight[r] : unassignedUnit * maxWeight;
+            }
+        }
+        for (int i = 0; i < orders; i++)
+        {
+            for (int c = 0; c < k; c++)
+            {
+                int d = nearestDistance[(size_t)i * k + c];
+                if (d == INF)
+                    continue;
+                int a = column[nearest[(size_t)i * k + c]];
+                if (orderRows)
+                    cost[(size_t)i * cols + a] = (long long)d * weight[i];
+                else
+                    cost[(size_t)a * cols + i] = (long long)d * weight[i] + unassignedUnit * (maxWeight - weight[i]);
+            }
+        }
 
-                cout << "\n============================================" << endl;
-                cout << "     ORDER DISPATCHED SUCCESSFULLY!        " << endl;
-                cout << "============================================" << endl;
+        vector<int> match = AssignmentSolver::solve(rows, cols, cost);
 
-                cout << "\n[URGENT ORDER #" << order.orderId << "]" << endl;
-                cout << "Customer: " << user->name << endl;
-                cout << "Restaurant: " << graph->getNodeName(restaurantNode) << endl;
-                cout << "Agent: " << agent->name << endl;
-                cout << "Distance: " << distance << " km" << endl;
-                cout << "ETA: " << eta << " minutes" << endl;
+        vector<int> assigned(orders, -1);
+        for (int r = 0; r < rows; r++)
+        {
+            int i = orderRows ? r : match[r];
+            int a = orderRows ? match[r] : r;
+            if (i < orders && a < agentCols && cost[(size_t)r * cols + match[r]] < forbidden)
+            {
+                assigned[i] = candidates[a];
+            }
+        }
 
-                graph->displayPath(restaurantNode, user->nodeId, parent, distance);
+        vector<vector<int>> routes(orders);
+        vector<int> routeDistance(orders, INF);
+        pool->parallelFor(orders, [&](int i)
+        {
+            if (assigned[i] != -1)
+            {
+                routeDistance[i] = graph->shortestRoute(restaurantNodeFor(pending[i]), customers[i]->nodeId, routes[i]);
+            }
+        });
 
-                orderHistory.insert(order);
-                assignmentHistory.push(Assignment(order.orderId, agent->id));
+        int dispatched = 0;
+        for (int i = 0; i < orders; i++)
+        {
+            if (assigned[i] != -1)
+            {
+                completeAssignment(pending[i], customers[i], freeAgents[assigned[i]], restaurantNodeFor(pending[i]),
+                                   routes[i], routeDistance[i], fromBacklog[i] ? "BACKLOG" : "URGENT");
                 dispatched++;
             }
+            else if (fromBacklog[i])
+            {
+                backlogOrders.enqueue(pending[i]);
+            }
             else
             {
-                cout << "\nNo agent available for urgent order " << order.orderId
-                     << ". Moving to backlog." << endl;
-                backlogOrders.enqueue(order);
+                reportDeferred(pending[i]);
+                retry.push_back(pending[i]);
             }
         }
+        for (const Order &order : retry)
+        {
+            backlogOrders.enqueue(order);
+        }
 
-        int backlogProcessed = 0;
-        Queue<Order> tempQueue;
+        reportDispatched(dispatched);
+    }
 
-        while (!backlogOrders.isEmpty() && backlogProcessed < 5)
+    long long replayOrders(istream &input, const string &source, const ReplayOptions &options, JsonLineWriter &output)
+    {
+        if (!graph)
         {
-            Order order = backlogOrders.dequeue();
+            cout << "Graph not loaded! Cannot replay orders." << endl;
+            return 0;
+        }
 
-            User *user = users.find(order.userId);
-            if (!user)
-            {
-                cout << "User not found for order " << order.orderId << endl;
-                continue;
-            }
+        events = &output;
+        int savedBacklogLimit = backlogLimit;
+        backlogLimit = options.ordersPerTick;
+        replayTick = 0;
 
-            int restaurantNode = order.restaurantId - 1;
-            Agent *agent = findNearestAgent(restaurantNode);
+        unordered_map<uint64_t, int> customers;
+        for (Node<User> *node = users.getHead(); node; node = node->next)
+        {
+            customers.emplace((uint64_t)node->data.name << 32 | (uint32_t)node->data.nodeId, node->data.id);
+        }
+        deque<vector<Agent *>> releases;
+        long long accepted = 0;
+        long long dispatched = 0;
 
-            if (agent)
+        auto runTick = [&]()
+        {
+            replayTick++;
+            if (!releases.empty())
             {
-                order.agentId = agent->id;
-                order.status = "Assigned";
-                agent->available = false;
+                for (Agent *agent : releases.front())
+                {
+                    agentLocator.setAvailable(agent, true);
+                }
+                releases.pop_front();
+            }
 
-                auto result = graph->dijkstraWithPath(restaurantNode, user->nodeId);
-                vector<int> distances = result.first;
-                vector<int> parent = result.second;
-                int distance = distances[user->nodeId];
-                int eta = (distance * 60) / 30;
+            dispatchedAgents.clear();
+            if (options.batch)
+                dispatchOrdersBatch();
+            else
+                dispatchOrders();
+            dispatched += dispatchedAgents.size();
+            if (replayTick % REPLAY_COMMIT_TICKS == 0)
+            {
+                commitOrders();
+            }
 
-                cout << "\n============================================" << endl;
-                cout << "     ORDER DISPATCHED SUCCESSFULLY!        " << endl;
-                cout << "============================================" << endl;
+            if (options.releaseTicks > 0 && !dispatchedAgents.empty())
+            {
+                if ((int)releases.size() < options.releaseTicks)
+                    releases.resize(options.releaseTicks);
+                vector<Agent *> &due = releases[options.releaseTicks - 1];
+                due.insert(due.end(), dispatchedAgents.begin(), dispatchedAgents.end());
+            }
 
-                cout << "\n[BACKLOG ORDER #" << order.orderId << "]" << endl;
-                cout << "Customer: " << user->name << endl;
-                cout << "Restaurant: " << graph->getNodeName(restaurantNode) << endl;
-                cout << "Agent: " << agent->name << endl;
-                cout << "Distance: " << distance << " km" << endl;
-                cout << "ETA: " << eta << " minutes" << endl;
+            string &out = output.line();
+            out += "{\"event\":\"tick\",\"tick\":";
+            out += to_string(replayTick);
+            out += ",\"dispatched\":";
+            out += to_string(dispatchedAgents.size());
+            out += ",\"pending\":";
+            out += to_string(urgentOrders.getSize() + backlogOrders.getSize());
+            out += ",\"free_agents\":";
+            out += to_string(agentLocator.freeCount());
+            out += '}';
+            output.endLine();
+        };
 
-                graph->displayPath(restaurantNode, user->nodeId, parent, distance);
+        string line;
+        int lineNumber = 0;
+        int inTick = 0;
+        vector<string_view> fields;
+        while (getline(input, line))
+        {
+            lineNumber++;
+            string_view text(line);
+            if (!text.empty() && text.back() == '\r')
+                text.remove_suffix(1);
+            if (text.find_first_not_of(" \t") == string_view::npos)
+                continue;
 
-                orderHistory.insert(order);
-                assignmentHistory.push(Assignment(order.orderId, agent->id));
-                dispatched++;
-                backlogProcessed++;
+            string_view name, node, restaurant, priority;
+            bool json = text[text.find_first_not_of(" \t")] == '{';
+            bool parsed;
+            if (json)
+            {
+                parsed = findJsonField(text, "user", name) && findJsonField(text, "node", node) &&
+                         findJsonField(text, "restaurant", restaurant) && findJsonField(text, "priority", priority);
             }
             else
             {
-                tempQueue.enqueue(order);
+                CsvReader reader(text);
+                parsed = reader.nextRow(fields) && fields.size() >= 4;
+                if (parsed)
+                {
+                    name = fields[0];
+                    node = fields[1];
+                    restaurant = fields[2];
+                    priority = fields[3];
+                }
             }
-        }
 
-        while (!backlogOrders.isEmpty())
-        {
-            tempQueue.enqueue(backlogOrders.dequeue());
-        }
-        while (!tempQueue.isEmpty())
-        {
-            backlogOrders.enqueue(tempQueue.dequeue());
+            int nodeId, restaurantId, orderPriority;
+            if (!parsed || !CsvReader::parseInt(node, nodeId) || !CsvReader::parseInt(restaurant, restaurantId) ||
+                !CsvReader::parseInt(priority, orderPriority) || !Order::validPriority(orderPriority) ||
+                !validNode(nodeId) || !restaurants.findById(restaurantId))
+            {
+                if (lineNumber > 1 || json)
+                    reportMalformed(source, lineNumber);
+                continue;
+            }
+
+            uint64_t key = (uint64_t)StringPool::intern(name) << 32 | (uint32_t)nodeId;
+            auto customer = customers.find(key);
+            int userId = customer != customers.end() ? customer->second : addUser(string(name), nodeId);
+            customers.emplace(key, userId);
+
+            placeOrder(userId, restaurantId, orderPriority);
+            accepted++;
+            if (++inTick == options.ordersPerTick)
+            {
+                runTick();
+                inTick = 0;
+            }
         }
 
-        if (dispatched > 0)
+        if (inTick > 0)
         {
-            cout << "\n>> " << dispatched << " order(s) dispatched successfully!" << endl;
-            saveOrderHistory("orders.csv");
+            runTick();
         }
-        else
+        while (urgentOrders.getSize() + backlogOrders.getSize() > 0 && !releases.empty())
         {
-            cout << "\nNo orders dispatched. No available agents or no pending orders." << endl;
+            runTick();
         }
+        commitOrders();
+
+        string &out = output.line();
+        out += "{\"event\":\"summary\",\"orders\":";
+        out += to_string(accepted);
+        out += ",\"dispatched\":";
+        out += to_string(dispatched);
+        out += ",\"pending\":";
+        out += to_string(urgentOrders.getSize() + backlogOrders.getSize());
+        out += ",\"ticks\":";
+        out += to_string(replayTick);
+        out += ",\"tree_cache_hits\":";
+        out += to_string(graph->getTreeCacheHits());
+        out += ",\"tree_cache_misses\":";
+        out += to_string(graph->getTreeCacheMisses());
+        out += '}';
+        output.endLine();
+        output.flush();
+
+        events = nullptr;
+        backlogLimit = savedBacklogLimit;
+        return dispatched;
     }
 
     void undoLastAssignment()
@@ -1195,11 +5164,11 @@ public:
 
         Assignment lastAssignment = assignmentHistory.pop();
 
-        Agent *agent = agents.find(lastAssignment.agentId);
+        Agent *agent = agentById.find(lastAssignment.agentId);
         if (agent)
         {
-            agent->available = true;
-            cout << "\nUndo successful! Agent " << agent->name << " is now available." << endl;
+            agentLocator.setAvailable(agent, true);
+            cout << "\nUndo successful! Agent " << StringPool::view(agent->name) << " is now available." << endl;
             cout << "Order " << lastAssignment.orderId << " assignment reverted." << endl;
         }
         else
@@ -1227,6 +5196,9 @@ public:
         cout << "\n========== Pending Orders ==========" << endl;
         cout << "Urgent orders in queue: " << urgentOrders.getSize() << endl;
         cout << "Backlog orders in queue: " << backlogOrders.getSize() << endl;
+        cout << "Orders waiting in intake: " << intake.approxSize()
+             << " (accepted " << intake.getPushed() << ", rejected " << intake.getRejected()
+             << ", drained " << intake.getDrained() << ")" << endl;
         cout << "====================================" << endl;
     }
 
@@ -1309,12 +5281,12 @@ public:
         cout << "------------------------------------------------" << endl;
 
         bool displayed[10][10] = {false};
+        graph->ensureFrozen();
         for (int i = 0; i < numNodes; i++)
         {
-            Node<Edge> *temp = graph->adjList[i].getHead();
-            while (temp)
+            for (int a = graph->arcOffsets[i]; a < graph->arcOffsets[i + 1]; a++)
             {
-                int j = temp->data.dest;
+                int j = graph->arcs[a].dest;
                 if (!displayed[i][j] && !displayed[j][i])
                 {
                     cout << "[" << i << "] " << graph->getNodeName(i);
@@ -1322,11 +5294,10 @@ public:
                     for (int p = 0; p < padding; p++)
                         cout << " ";
                     cout << " <---> [" << j << "] " << graph->getNodeName(j) << endl;
-                    cout << "     via " << temp->data.streetName << " (" << temp->data.weight << " km)" << endl;
+                    cout << "     via " << graph->strings.view(graph->edgeStreets[graph->arcEdge[a]]) << " (" << graph->arcs[a].weight << " km)" << endl;
                     cout << endl;
                     displayed[i][j] = displayed[j][i] = true;
                 }
-                temp = temp->next;
             }
         }
         cout << "================================================" << endl;
@@ -1365,13 +5336,161 @@ void displayMenu()
     cout << "7. Undo Last Assignment" << endl;
     cout << "8. Display Order History" << endl;
     cout << "9. Display Pending Orders" << endl;
+    cout << "10. Batch Dispatch (Optimal Assignment)" << endl;
+    cout << "11. Search Restaurants by Name" << endl;
     cout << "0. Exit" << endl;
     cout << "============================================" << endl;
     cout << "Enter your choice: ";
 }
 
-int main()
+#ifndef FOOD_DELIVERY_NO_MAIN
+int runHeadless(int argc, char **argv)
+{
+    ReplayOptions options;
+    string source;
+    string outputFile;
+    string dataDir;
+    bool buildHierarchy = true;
+    bool buildTable = true;
+    bool persist = false;
+    int routeMode = -1;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        string value = i + 1 < argc ? argv[i + 1] : "";
+        int number = 0;
+        if (arg == "--stream" && !value.empty())
+        {
+            source = value;
+            i++;
+        }
+        else if (arg == "--out" && !value.empty())
+        {
+            outputFile = value;
+            i++;
+        }
+        else if (arg == "--data" && !value.empty())
+        {
+            dataDir = value;
+            i++;
+        }
+        else if (arg == "--tick" && CsvReader::parseInt(value, number) && number > 0)
+        {
+            options.ordersPerTick = number;
+            i++;
+        }
+        else if (arg == "--release-ticks" && CsvReader::parseInt(value, number) && number >= 0)
+        {
+            options.releaseTicks = number;
+            i++;
+        }
+        else if (arg == "--batch")
+        {
+            options.batch = true;
+        }
+        else if (arg == "--persist")
+        {
+            persist = true;
+        }
+        else if (arg == "--route" && (value == "tree" || value == "bidirectional" || value == "alt"))
+        {
+            routeMode = value == "tree" ? ROUTE_TREE : value == "bidirectional" ? ROUTE_BIDIRECTIONAL : ROUTE_ALT;
+            i++;
+        }
+        else if (arg == "--no-hierarchy")
+        {
+            buildHierarchy = false;
+        }
+        else if (arg == "--no-table")
+        {
+            buildTable = false;
+        }
+        else
+        {
+            source.clear();
+            break;
+        }
+    }
+
+    if (source.empty())
+    {
+        fprintf(stderr,
+                "Usage: %s --stream FILE|- [--tick N] [--release-ticks N] [--batch] [--data DIR] [--out FILE]\n"
+                "          [--persist] [--route tree|bidirectional|alt] [--no-hierarchy] [--no-table]\n",
+                argv[0]);
+        return 1;
+    }
+
+    FILE *out = outputFile.empty() ? stdout : fopen(outputFile.c_str(), "wb");
+    if (!out)
+    {
+        fprintf(stderr, "Error: Could not open output file: %s\n", outputFile.c_str());
+        return 1;
+    }
+
+    ifstream file;
+    if (source != "-")
+    {
+        file.open(source, ios::binary);
+        if (!file)
+        {
+            fprintf(stderr, "Error: Could not open order stream: %s\n", source.c_str());
+            if (out != stdout)
+            {
+                fclose(out);
+            }
+            return 1;
+        }
+    }
+    else
+    {
+        ios::sync_with_stdio(false);
+    }
+
+    const char *dataFiles[] = {"nodes.csv", "edges.csv", "restaurants.csv", "users.csv", "agents.csv", "orders.csv", "orders.journal"};
+    vector<long long> stamps;
+    for (const char *name : dataFiles)
+    {
+        stamps.push_back(DurableFile::modifiedAt(dataDir.empty() ? name : dataDir + "/" + name));
+    }
+
+    streambuf *saved = cout.rdbuf(cerr.rdbuf());
+    {
+        FoodDeliverySimulator simulator(dataDir, buildHierarchy, buildTable, persist);
+        if (routeMode != -1 && simulator.getGraph())
+        {
+            simulator.getGraph()->setRouteMode((RouteMode)routeMode);
+        }
+        JsonLineWriter writer(out);
+        simulator.replayOrders(source == "-" ? cin : file, source == "-" ? "stdin" : source, options, writer);
+    }
+    cout.rdbuf(saved);
+
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+
+    int status = 0;
+    for (size_t i = 0; i < stamps.size() && !persist; i++)
+    {
+        string path = dataDir.empty() ? dataFiles[i] : dataDir + "/" + dataFiles[i];
+        if (DurableFile::modifiedAt(path) != stamps[i])
+        {
+            fprintf(stderr, "Error: replay modified %s without --persist\n", path.c_str());
+            status = 1;
+        }
+    }
+    return status;
+}
+
+int main(int argc, char **argv)
 {
+    if (argc > 1)
+    {
+        return runHeadless(argc, argv);
+    }
+
     FoodDeliverySimulator simulator;
     int choice;
 
@@ -1433,6 +5552,14 @@ int main()
             simulator.displayPendingOrders();
             waitForBack();
             break;
+        case 10:
+            simulator.dispatchOrdersBatch();
+            waitForBack();
+            break;
+        case 11:
+            simulator.searchRestaurants();
+            waitForBack();
+            break;
         case 0:
             clearScreen();
             cout << "\nThank you for using the Food Delivery Simulator!" << endl;
@@ -1445,3 +5572,4 @@ int main()
 
     return 0;
 }
+#endif